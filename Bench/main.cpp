@@ -0,0 +1,210 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "Headless.h"
+#include "InstancedRects.h"
+#include "ProgramCache.h"
+#include "QuadBatch.h"
+#include "ShaderPipeline.h"
+
+/*
+The render benchmark suite. Runs without a window and writes its results in a form that can be
+compared between runs: one record per measured value, tagged with the GL vendor, renderer and version.
+
+    Bench [--sizes 10,100,...] [--json FILE] [--csv FILE]
+
+Without --json or --csv the JSON goes to stdout. Progress is printed to stderr.
+*/
+
+const unsigned int defaultSizes[] = { 10, 100, 1000, 10000, 100000, 1000000 };
+const size_t uploadSizes[] = { 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+const int SHADER_BUILD_ITERATIONS = 10;
+// every upload test moves about this much data
+const size_t UPLOAD_TOTAL_BYTES = 256 * 1024 * 1024;
+
+struct Record
+{
+    const char* suite;  // "draw", "shader" or "upload"
+    std::string name;   // draw path, program or upload method
+    double size;        // rectangles or bytes, 0 if it doesn't apply
+    const char* metric;
+    double value;
+};
+
+static std::string jsonString(const char* text)
+{
+    std::string out = "\"";
+    for (const char* c = text ? text : ""; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            out += '\\';
+        out += *c;
+    }
+    return out + "\"";
+}
+
+static void writeJSON(FILE* file, const std::vector<Record>& records)
+{
+    fprintf(file, "{\n  \"gl\": { \"vendor\": %s, \"renderer\": %s, \"version\": %s },\n  \"results\": [",
+        jsonString((const char*)glGetString(GL_VENDOR)).c_str(),
+        jsonString((const char*)glGetString(GL_RENDERER)).c_str(),
+        jsonString((const char*)glGetString(GL_VERSION)).c_str());
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const Record& r = records[i];
+        fprintf(file, "%s\n    { \"suite\": \"%s\", \"name\": %s, \"size\": %.0f, \"metric\": \"%s\", \"value\": %.6f }",
+            i ? "," : "", r.suite, jsonString(r.name.c_str()).c_str(), r.size, r.metric, r.value);
+    }
+    fprintf(file, "\n  ]\n}\n");
+}
+
+static void writeCSV(FILE* file, const std::vector<Record>& records)
+{
+    fprintf(file, "suite,name,size,metric,value\n");
+    for (const Record& r : records)
+        fprintf(file, "%s,%s,%.0f,%s,%.6f\n", r.suite, r.name.c_str(), r.size, r.metric, r.value);
+}
+
+static bool writeFile(const char* path, const std::vector<Record>& records, void (*write)(FILE*, const std::vector<Record>&))
+{
+    FILE* file = fopen(path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "ERROR::BENCH::CANNOT_WRITE %s\n", path);
+        return false;
+    }
+    write(file, records);
+    fclose(file);
+    return true;
+}
+
+static std::vector<unsigned int> parseSizes(const char* list)
+{
+    std::vector<unsigned int> sizes;
+    for (const char* c = list; *c; )
+    {
+        char* end;
+        unsigned long size = strtoul(c, &end, 10);
+        if (end == c)
+            break;
+        sizes.push_back((unsigned int)size);
+        c = *end == ',' ? end + 1 : end;
+    }
+    return sizes;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<unsigned int> sizes(defaultSizes, defaultSizes + sizeof(defaultSizes) / sizeof(defaultSizes[0]));
+    const char* jsonPath = NULL;
+    const char* csvPath = NULL;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc)
+            sizes = parseSizes(argv[++i]);
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            jsonPath = argv[++i];
+        else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+            csvPath = argv[++i];
+    }
+
+    HeadlessContext context;
+    if (!context.create())
+    {
+        fprintf(stderr, "Headless OpenGL context creation failed!\n");
+        return EXIT_FAILURE;
+    }
+    if (!gladLoadGLLoader(context.loader()))
+    {
+        fprintf(stderr, "Failed to initialize GLAD\n");
+        context.destroy();
+        return EXIT_FAILURE;
+    }
+    glExt.load(context.loader());
+    shaderPipeline.init();
+    OffscreenTarget target;
+    if (!target.create(640, 480))
+    {
+        context.destroy();
+        return EXIT_FAILURE;
+    }
+    target.bind();
+    glState.viewport(0, 0, 640, 480);
+    fprintf(stderr, "%s, %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+
+    std::vector<Record> records;
+
+    // submission cost of every draw path
+    for (unsigned int count : sizes)
+    {
+        std::vector<Panel> scene = makeBenchScene(count);
+        for (int path = 0; path < DRAW_PATH_COUNT; path++)
+        {
+            BenchResult result = benchDrawPath((DrawPath)path, scene);
+            fprintf(stderr, "draw    %-10s %8u rects %10.3f cpu ms %10.3f frame ms\n",
+                drawPathNames[path], count, result.cpuMs, result.frameMs);
+            records.push_back({ "draw", drawPathNames[path], (double)count, "cpu_ms", result.cpuMs });
+            records.push_back({ "draw", drawPathNames[path], (double)count, "frame_ms", result.frameMs });
+            records.push_back({ "draw", drawPathNames[path], (double)count, "frames", (double)result.frames });
+        }
+    }
+
+    // building the programs the draw paths use
+    std::string quadBatchVertex = quadBatchVertexShader(QUAD_VERTEX_FLOAT);
+    struct { const char* name; const char* vertex; const char* fragment; } programs[] = {
+        { "quad batch", quadBatchVertex.c_str(), quadBatchFragmentShaderSource },
+        { "instanced", instancedVertexShaderSource, instancedFragmentShaderSource }
+    };
+    for (const auto& program : programs)
+    {
+        ShaderBuildResult result = benchShaderBuild(program.vertex, program.fragment, SHADER_BUILD_ITERATIONS);
+        fprintf(stderr, "shader  %-10s %10.3f compile ms %10.3f link ms\n", program.name, result.compileMs, result.linkMs);
+        records.push_back({ "shader", program.name, 0.0, "compile_ms", result.compileMs });
+        records.push_back({ "shader", program.name, 0.0, "link_ms", result.linkMs });
+    }
+    // the same programs at startup, built from source versus loaded from the program cache
+    if (programCache.init("shadercache"))
+    {
+        for (const auto& program : programs)
+        {
+            ProgramCacheResult result = benchProgramCache(program.vertex, program.fragment, SHADER_BUILD_ITERATIONS);
+            fprintf(stderr, "shader  %-10s %10.3f cold ms %10.3f warm ms\n", program.name, result.coldMs, result.warmMs);
+            records.push_back({ "shader", program.name, 0.0, "cold_ms", result.coldMs });
+            records.push_back({ "shader", program.name, 0.0, "warm_ms", result.warmMs });
+        }
+        programCache.shutdown();
+    }
+    else
+        fprintf(stderr, "shader  no program binary support, cold/warm startup skipped\n");
+
+    // vertex buffer upload throughput
+    for (size_t bytes : uploadSizes)
+        for (int method = 0; method < UPLOAD_METHOD_COUNT; method++)
+        {
+            int iterations = (int)std::max<size_t>(UPLOAD_TOTAL_BYTES / bytes, 4);
+            double mbPerSecond = benchUpload((UploadMethod)method, bytes, iterations);
+            fprintf(stderr, "upload  %-20s %10zu bytes %10.1f MB/s\n", uploadMethodNames[method], bytes, mbPerSecond);
+            records.push_back({ "upload", uploadMethodNames[method], (double)bytes, "mb_per_s", mbPerSecond });
+        }
+
+    int result = 0;
+    if (jsonPath && !writeFile(jsonPath, records, writeJSON))
+        result = EXIT_FAILURE;
+    if (csvPath && !writeFile(csvPath, records, writeCSV))
+        result = EXIT_FAILURE;
+    if (!jsonPath && !csvPath)
+        writeJSON(stdout, records);
+
+    shaderPipeline.destroy();
+    target.destroy();
+    context.destroy();
+    return result;
+}
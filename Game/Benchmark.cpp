@@ -0,0 +1,631 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.h"
+#include "FrameSync.h"
+#include "GLState.h"
+#include "IndexedMesh.h"
+#include "InstancedRects.h"
+#include "MaterialTable.h"
+#include "PanelGroups.h"
+#include "ProgramCache.h"
+#include "QuadBatch.h"
+#include "RenderDevice.h"
+#include "RenderQueue.h"
+#include "Shader.h"
+#include "ShaderPipeline.h"
+#include "SoftwareRasterizer.h"
+#include "StreamBuffer.h"
+#include "UniformRing.h"
+
+// The original one-program-per-color shaders, kept here so the old path can be measured.
+static const char* legacyVertexShaderSource = "#version 330 core\n"
+"layout (location = 0) in vec3 aPos;\n"
+"void main()\n"
+"{\n"
+"   gl_Position = vec4(aPos.x, aPos.y, aPos.z, 1.0);\n"
+"}\0";
+
+static const char* legacyFragmentShaderSources[] = {
+    "#version 330 core\nout vec4 FragColor;\nvoid main()\n{\n   FragColor = vec4(0.5f, 0.0f, 1.0f, 1.0f);\n}\n\0",
+    "#version 330 core\nout vec4 FragColor;\nvoid main()\n{\n   FragColor = vec4(1.0f, 1.0f, 0.0f, 1.0f);\n}\n\0",
+    "#version 330 core\nout vec4 FragColor;\nvoid main()\n{\n   FragColor = vec4(0.69f, 0.42f, 0.0f, 1.0f);\n}\n\0",
+    "#version 330 core\nout vec4 FragColor;\nvoid main()\n{\n   FragColor = vec4(0.5f, 0.5f, 0.5f, 1.0f);\n}\n\0"
+};
+
+static const float legacyColors[4][3] = {
+    { 0.5f, 0.0f, 1.0f }, { 1.0f, 1.0f, 0.0f }, { 0.69f, 0.42f, 0.0f }, { 0.5f, 0.5f, 0.5f }
+};
+
+// A rectangle per draw from four gl_VertexID corners, with its rectangle and color as plain uniforms or as the
+// "DrawConstants" block of a UniformRing.
+static const char* perDrawUniformsVertexShaderSource = "#version 330 core\n"
+"uniform vec4 uRect;\n"
+"uniform vec4 uColor;\n"
+"out vec4 vColor;\n"
+"void main()\n"
+"{\n"
+"   vec2 corner = vec2(gl_VertexID >> 1, gl_VertexID & 1);\n"
+"   gl_Position = vec4(uRect.xy + corner * uRect.zw, 0.0, 1.0);\n"
+"   vColor = uColor;\n"
+"}\0";
+
+static const char* perDrawBlockVertexShaderSource = "#version 330 core\n"
+"layout (std140) uniform DrawConstants\n"
+"{\n"
+"   vec4 uRect;\n"
+"   vec4 uColor;\n"
+"};\n"
+"out vec4 vColor;\n"
+"void main()\n"
+"{\n"
+"   vec2 corner = vec2(gl_VertexID >> 1, gl_VertexID & 1);\n"
+"   gl_Position = vec4(uRect.xy + corner * uRect.zw, 0.0, 1.0);\n"
+"   vColor = uColor;\n"
+"}\0";
+
+static const char* perDrawFragmentShaderSource = "#version 330 core\n"
+"in vec4 vColor;\n"
+"out vec4 FragColor;\n"
+"void main()\n"
+"{\n"
+"   FragColor = vColor;\n"
+"}\n\0";
+
+const int BENCH_FRAMES = 60;
+// A path that is this slow stops measuring early, the per-VAO path needs seconds per frame at a million rects.
+const double BENCH_BUDGET_MS = 2000.0;
+const int BENCH_MIN_FRAMES = 3;
+const unsigned int sceneSizes[] = { 100, 1000, 10000, 100000 };
+
+const char* const drawPathNames[DRAW_PATH_COUNT] = {
+    "per-VAO", "sorted", "batched", "instanced", "indexed", "re-upload", "streamed", "uniforms", "ubo-ring", "groups", "multi-draw", "packed"
+};
+const char* const uploadMethodNames[UPLOAD_METHOD_COUNT] = {
+    "glBufferData", "glBufferSubData", "orphan", "map-invalidate", "ring-persistent", "ring-unsynchronized"
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Small deterministic random generator so every run draws the same scene.
+static float nextRandom(unsigned int& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+std::vector<Panel> makeBenchScene(unsigned int count)
+{
+    std::vector<Panel> scene(count);
+    unsigned int state = 12345;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        Panel& p = scene[i];
+        p.w = 0.01f + nextRandom(state) * 0.1f;
+        p.h = 0.01f + nextRandom(state) * 0.1f;
+        p.x = -1.0f + nextRandom(state) * (2.0f - p.w);
+        p.y = -1.0f + nextRandom(state) * (2.0f - p.h);
+        const float* color = legacyColors[i % 4];
+        p.r = color[0];
+        p.g = color[1];
+        p.b = color[2];
+        p.a = 1.0f;
+    }
+    return scene;
+}
+
+template <typename DrawFunction>
+static BenchResult measure(DrawFunction draw)
+{
+    // warm up so buffer uploads and shader compilation in the driver are not measured
+    frameSync.beginFrame();
+    draw();
+    frameSync.endFrame();
+    glFinish();
+
+    BenchResult result = { 0.0, 0.0, 0 };
+    while (result.frames < BENCH_FRAMES && (result.frames < BENCH_MIN_FRAMES || result.frameMs < BENCH_BUDGET_MS))
+    {
+        Clock::time_point start = Clock::now();
+        frameSync.beginFrame();
+        glClear(GL_COLOR_BUFFER_BIT);
+        draw();
+        result.cpuMs += millisecondsSince(start);
+        // after the CPU time, some drivers flush when a fence is inserted
+        frameSync.endFrame();
+        glFinish();
+        result.frameMs += millisecondsSince(start);
+        result.frames++;
+    }
+    result.cpuMs /= result.frames;
+    result.frameMs /= result.frames;
+    return result;
+}
+
+// One VAO/VBO with six vec3 vertices per rectangle and a program switch per draw, like main() used to do.
+// With sorted set the same draws go through a RenderQueue, which groups them by program where they don't overlap.
+static BenchResult benchLegacy(const std::vector<Panel>& scene, bool sorted)
+{
+    unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, legacyVertexShaderSource, "VERTEX");
+    unsigned int programs[4];
+    for (int i = 0; i < 4; i++)
+    {
+        unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, legacyFragmentShaderSources[i], "FRAGMENT");
+        programs[i] = linkProgram(vertexShader, fragmentShader);
+        glDeleteShader(fragmentShader);
+    }
+    glDeleteShader(vertexShader);
+
+    std::vector<unsigned int> VAO(scene.size()), VBO(scene.size());
+    glGenVertexArrays((GLsizei)scene.size(), VAO.data());
+    glGenBuffers((GLsizei)scene.size(), VBO.data());
+    for (size_t i = 0; i < scene.size(); i++)
+    {
+        const Panel& p = scene[i];
+        float vertices[] = {
+            p.x,       p.y,       0.0f,
+            p.x,       p.y + p.h, 0.0f,
+            p.x + p.w, p.y + p.h, 0.0f,
+
+            p.x + p.w, p.y + p.h, 0.0f,
+            p.x + p.w, p.y,       0.0f,
+            p.x,       p.y,       0.0f
+        };
+        glBindVertexArray(VAO[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO[i]);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    RenderQueue queue;
+    BenchResult result = measure([&]() {
+        for (size_t i = 0; i < VAO.size(); i++)
+        {
+            if (sorted)
+            {
+                DrawCommand command;
+                command.program = programs[i % 4];
+                command.vertexArray = VAO[i];
+                command.count = 6;
+                command.x = scene[i].x;
+                command.y = scene[i].y;
+                command.w = scene[i].w;
+                command.h = scene[i].h;
+                queue.submit(command);
+                continue;
+            }
+            glUseProgram(programs[i % 4]);
+            glBindVertexArray(VAO[i]);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        }
+        if (sorted)
+            queue.flush();
+    });
+
+    glDeleteVertexArrays((GLsizei)VAO.size(), VAO.data());
+    glDeleteBuffers((GLsizei)VBO.size(), VBO.data());
+    for (int i = 0; i < 4; i++)
+        glDeleteProgram(programs[i]);
+    // the unsorted path talks to OpenGL directly, so the state cache no longer knows what is bound
+    glState.invalidate();
+    return result;
+}
+
+static BenchResult benchBatched(const std::vector<Panel>& scene, QuadVertexFormat format)
+{
+    unsigned int program = createProgram(quadBatchVertexShader(format).c_str(), quadBatchFragmentShaderSource);
+    QuadBatch batch;
+    batch.init((unsigned int)scene.size(), format);
+    batch.begin();
+    for (const Panel& panel : scene)
+        batch.submit(panel);
+    batch.end();
+
+    BenchResult result = measure([&]() {
+        glState.useProgram(program);
+        batch.draw();
+    });
+
+    batch.destroy();
+    glState.deleteProgram(program);
+    return result;
+}
+
+// With everyFrame set the instances are submitted and uploaded again before every draw, like geometry that
+// changes all the time, either with glBufferSubData or through a StreamBuffer.
+static BenchResult benchInstanced(const std::vector<Panel>& scene, bool everyFrame, InstanceUpload upload)
+{
+    InstancedRects rects;
+    if (!rects.init((unsigned int)scene.size(), upload))
+        return BenchResult{ 0.0, 0.0, 0 };
+    // building the program is not part of what is measured
+    shaderPipeline.finish();
+    MaterialTable materials;
+    materials.init();
+    materials.upload();
+    auto submit = [&]() {
+        rects.begin();
+        for (const Panel& p : scene)
+            rects.submit({ p.x, p.y, p.w, p.h, packColor(p.r, p.g, p.b, p.a), 0.0f, 0, 0.0f });
+        rects.end();
+    };
+    submit();
+
+    BenchResult result = measure([&]() {
+        if (everyFrame)
+            submit();
+        materials.bind();
+        rects.draw();
+    });
+
+    rects.destroy();
+    materials.destroy();
+    return result;
+}
+
+static BenchResult benchIndexed(const std::vector<Panel>& scene)
+{
+    unsigned int program = createProgram(quadBatchVertexShader(QUAD_VERTEX_FLOAT).c_str(), quadBatchFragmentShaderSource);
+    MeshBuilder builder;
+    for (const Panel& panel : scene)
+        builder.addQuad(panel);
+    builder.optimize();
+    IndexedMesh mesh;
+    mesh.upload(builder);
+
+    BenchResult result = measure([&]() {
+        glState.useProgram(program);
+        mesh.draw();
+    });
+
+    mesh.destroy();
+    glState.deleteProgram(program);
+    return result;
+}
+
+// A draw call per rectangle with its own constants. The uniforms path makes two glUniform4fv calls per draw; the
+// ring path copies the constants of every draw into a UniformRing with one memcpy each and binds a range per draw.
+static BenchResult benchPerDrawConstants(const std::vector<Panel>& scene, bool ring)
+{
+    struct DrawConstants
+    {
+        float rect[4];
+        float color[4];
+    };
+    std::vector<DrawConstants> constants(scene.size());
+    for (size_t i = 0; i < scene.size(); i++)
+    {
+        const Panel& p = scene[i];
+        constants[i] = { { p.x, p.y, p.w, p.h }, { p.r, p.g, p.b, p.a } };
+    }
+
+    unsigned int program = createProgram(ring ? perDrawBlockVertexShaderSource : perDrawUniformsVertexShaderSource,
+        perDrawFragmentShaderSource);
+    int rectLocation = glGetUniformLocation(program, "uRect");
+    int colorLocation = glGetUniformLocation(program, "uColor");
+    UniformRing::attachToProgram(program);
+    UniformRing uniforms;
+    // with an offset alignment above 32 bytes the warm-up frame grows the ring to fit
+    if (ring)
+        uniforms.init(scene.size() * sizeof(DrawConstants));
+    // the core profile doesn't draw without a VAO bound
+    unsigned int emptyVAO = renderDevice.createVertexArray();
+
+    BenchResult result = measure([&]() {
+        glState.useProgram(program);
+        glState.bindVertexArray(emptyVAO);
+        if (!ring)
+        {
+            for (const DrawConstants& draw : constants)
+            {
+                glUniform4fv(rectLocation, 1, draw.rect);
+                glUniform4fv(colorLocation, 1, draw.color);
+                glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+            }
+            return;
+        }
+        size_t stride = uniforms.align(sizeof(DrawConstants));
+        StreamAllocation allocation = uniforms.map(stride * constants.size());
+        if (!allocation.data)
+            return;
+        for (size_t i = 0; i < constants.size(); i++)
+            memcpy((unsigned char*)allocation.data + i * stride, &constants[i], sizeof(DrawConstants));
+        uniforms.unmap();
+        UniformSlice slice;
+        slice.buffer = allocation.buffer;
+        slice.size = sizeof(DrawConstants);
+        for (size_t i = 0; i < constants.size(); i++)
+        {
+            slice.offset = allocation.offset + i * stride;
+            UniformRing::bind(DRAW_CONSTANTS_BINDING, slice);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        }
+    });
+
+    uniforms.destroy();
+    glState.deleteVertexArray(emptyVAO);
+    glState.deleteProgram(program);
+    return result;
+}
+
+// The scene in groups of GROUP_PANELS rectangles, every group a draw of its own with its own offset.
+const unsigned int GROUP_PANELS = 100;
+
+static BenchResult benchGroups(const std::vector<Panel>& scene, bool indirect)
+{
+    unsigned int program = createProgram(panelGroupsVertexShader().c_str(), quadBatchFragmentShaderSource);
+    PanelGroups groups;
+    groups.init(indirect);
+    if (indirect && !groups.usesIndirect())
+        fprintf(stderr, "multi-draw indirect is not supported, measuring the fallback\n");
+    for (size_t i = 0; i < scene.size(); i++)
+    {
+        if (i % GROUP_PANELS == 0)
+            groups.beginGroup();
+        groups.submit(scene[i]);
+    }
+    groups.end();
+
+    BenchResult result = measure([&]() {
+        glState.useProgram(program);
+        groups.draw();
+    });
+
+    groups.destroy();
+    glState.deleteProgram(program);
+    return result;
+}
+
+BenchResult benchDrawPath(DrawPath path, const std::vector<Panel>& scene)
+{
+    switch (path)
+    {
+    case DRAW_PATH_PER_VAO:
+        return benchLegacy(scene, false);
+    case DRAW_PATH_SORTED:
+        return benchLegacy(scene, true);
+    case DRAW_PATH_BATCHED:
+        return benchBatched(scene, QUAD_VERTEX_FLOAT);
+    case DRAW_PATH_INSTANCED:
+        return benchInstanced(scene, false, INSTANCES_STATIC);
+    case DRAW_PATH_INDEXED:
+        return benchIndexed(scene);
+    case DRAW_PATH_REUPLOAD:
+        return benchInstanced(scene, true, INSTANCES_STATIC);
+    case DRAW_PATH_STREAMED:
+        return benchInstanced(scene, true, INSTANCES_STREAMED);
+    case DRAW_PATH_UNIFORMS:
+        return benchPerDrawConstants(scene, false);
+    case DRAW_PATH_UBO_RING:
+        return benchPerDrawConstants(scene, true);
+    case DRAW_PATH_GROUPS:
+        return benchGroups(scene, false);
+    case DRAW_PATH_MULTI_DRAW:
+        return benchGroups(scene, true);
+    case DRAW_PATH_PACKED:
+        return benchBatched(scene, QUAD_VERTEX_PACKED);
+    default:
+        return BenchResult{ 0.0, 0.0, 0 };
+    }
+}
+
+ShaderBuildResult benchShaderBuild(const char* vertexSource, const char* fragmentSource, int iterations)
+{
+    ShaderBuildResult result = { 0.0, 0.0 };
+    for (int i = 0; i < iterations; i++)
+    {
+        // a different trailing comment every time, drivers that cache compiled shaders key them on the source
+        std::string salt = "\n// " + std::to_string(i) + " " + std::to_string(Clock::now().time_since_epoch().count()) + "\n";
+        std::string vertex = std::string(vertexSource) + salt;
+        std::string fragment = std::string(fragmentSource) + salt;
+
+        Clock::time_point start = Clock::now();
+        unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertex.c_str(), "VERTEX");
+        unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragment.c_str(), "FRAGMENT");
+        // compileShader asks for the compile status, so the compile really happened by now
+        result.compileMs += millisecondsSince(start);
+
+        start = Clock::now();
+        unsigned int program = vertexShader && fragmentShader ? linkProgram(vertexShader, fragmentShader) : 0;
+        result.linkMs += millisecondsSince(start);
+
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        glDeleteProgram(program);
+    }
+    result.compileMs /= iterations;
+    result.linkMs /= iterations;
+    return result;
+}
+
+ProgramCacheResult benchProgramCache(const char* vertexSource, const char* fragmentSource, int iterations)
+{
+    ProgramCacheResult result = { 0.0, 0.0 };
+    for (int i = 0; i < iterations; i++)
+    {
+        // salted like above, so the cold run isn't warmed up by the driver's own cache or an earlier run
+        std::string salt = "\n// " + std::to_string(i) + " " + std::to_string(Clock::now().time_since_epoch().count()) + "\n";
+        std::string vertex = std::string(vertexSource) + salt;
+        std::string fragment = std::string(fragmentSource) + salt;
+
+        Clock::time_point start = Clock::now();
+        unsigned int program = createProgram(vertex.c_str(), fragment.c_str());
+        result.coldMs += millisecondsSince(start);
+        glDeleteProgram(program);
+
+        start = Clock::now();
+        program = createProgram(vertex.c_str(), fragment.c_str());
+        result.warmMs += millisecondsSince(start);
+        glDeleteProgram(program);
+
+        programCache.remove(vertex.c_str(), fragment.c_str());
+    }
+    result.coldMs /= iterations;
+    result.warmMs /= iterations;
+    return result;
+}
+
+double benchUpload(UploadMethod method, size_t bytes, int iterations)
+{
+    std::vector<unsigned char> data(bytes);
+    unsigned int state = 1;
+    for (unsigned char& byte : data)
+        byte = (unsigned char)(nextRandom(state) * 255.0f);
+
+    unsigned int buffer;
+    glGenBuffers(1, &buffer);
+    glState.bindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+    StreamBuffer stream;
+    if (method == UPLOAD_STREAM_PERSISTENT || method == UPLOAD_STREAM_UNSYNCHRONIZED)
+        stream.init(bytes, method == UPLOAD_STREAM_PERSISTENT);
+    glFinish();
+
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        switch (method)
+        {
+        case UPLOAD_BUFFER_DATA:
+            glBufferData(GL_ARRAY_BUFFER, bytes, data.data(), GL_STREAM_DRAW);
+            break;
+        case UPLOAD_BUFFER_SUB_DATA:
+            glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, data.data());
+            break;
+        case UPLOAD_ORPHAN:
+            glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, data.data());
+            break;
+        case UPLOAD_MAP_INVALIDATE:
+        {
+            void* mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if (mapped)
+            {
+                memcpy(mapped, data.data(), bytes);
+                glUnmapBuffer(GL_ARRAY_BUFFER);
+            }
+            break;
+        }
+        case UPLOAD_STREAM_PERSISTENT:
+        case UPLOAD_STREAM_UNSYNCHRONIZED:
+        {
+            // every iteration is a frame of its own
+            frameSync.beginFrame();
+            StreamAllocation allocation = stream.map(bytes);
+            if (allocation.data)
+            {
+                memcpy(allocation.data, data.data(), bytes);
+                stream.unmap();
+            }
+            frameSync.endFrame();
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    glFinish();
+    double seconds = millisecondsSince(start) / 1000.0;
+
+    stream.destroy();
+    glState.deleteBuffer(buffer);
+    return (double)bytes * iterations / (1024.0 * 1024.0) / seconds;
+}
+
+void runBenchmark(GLFWwindow* window)
+{
+    // don't let vsync cap the measurements, a headless context has no window and no vsync
+    if (window)
+        glfwSwapInterval(0);
+
+    printf("%-10s %-10s %12s %12s\n", "rects", "path", "cpu ms", "frame ms");
+    for (unsigned int count : sceneSizes)
+    {
+        std::vector<Panel> scene = makeBenchScene(count);
+        for (int path = 0; path < DRAW_PATH_COUNT; path++)
+        {
+            BenchResult result = benchDrawPath((DrawPath)path, scene);
+            printf("%-10u %-10s %12.3f %12.3f\n", count, drawPathNames[path], result.cpuMs, result.frameMs);
+        }
+        if (!window)
+            continue;
+        glfwPollEvents();
+        if (glfwWindowShouldClose(window))
+            break;
+    }
+}
+
+// Fewer frames than the GPU paths, a single thread needs a while for the big scenes.
+const int SOFTWARE_BENCH_FRAMES = 10;
+
+static double benchSoftware(const std::vector<MeshVertex>& triangles, unsigned int threads)
+{
+    SoftwareRasterizer rasterizer(threads);
+    rasterizer.resize(640, 480);
+    auto draw = [&]() {
+        rasterizer.clear(0.0f, 0.0f, 0.0f, 0.0f);
+        rasterizer.drawTriangles(triangles.data(), (unsigned int)triangles.size());
+        rasterizer.flush();
+    };
+    draw();
+
+    Clock::time_point start = Clock::now();
+    for (int frame = 0; frame < SOFTWARE_BENCH_FRAMES; frame++)
+        draw();
+    return millisecondsSince(start) / SOFTWARE_BENCH_FRAMES;
+}
+
+void runSoftwareBenchmark()
+{
+    std::vector<unsigned int> threadCounts;
+    unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (unsigned int threads = 1; threads < hardwareThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(hardwareThreads);
+
+    printf("software rasterizer, %s inner loop\n", SoftwareRasterizer(1).simdPath());
+    printf("%-10s %-10s %12s %12s\n", "rects", "threads", "frame ms", "speedup");
+    for (unsigned int count : sceneSizes)
+    {
+        // the same triangles the batched path sends to the GPU
+        std::vector<Panel> scene = makeBenchScene(count);
+        std::vector<MeshVertex> triangles;
+        triangles.reserve(scene.size() * 6);
+        for (const Panel& p : scene)
+        {
+            MeshVertex corners[4] = {
+                { p.x, p.y, p.r, p.g, p.b, p.a },
+                { p.x + p.w, p.y, p.r, p.g, p.b, p.a },
+                { p.x + p.w, p.y + p.h, p.r, p.g, p.b, p.a },
+                { p.x, p.y + p.h, p.r, p.g, p.b, p.a }
+            };
+            const int order[6] = { 0, 1, 2, 0, 2, 3 };
+            for (int i : order)
+                triangles.push_back(corners[i]);
+        }
+
+        double singleThread = 0.0;
+        for (unsigned int threads : threadCounts)
+        {
+            double ms = benchSoftware(triangles, threads);
+            if (threads == 1)
+                singleThread = ms;
+            printf("%-10u %-10u %12.3f %11.2fx\n", count, threads, ms, singleThread / ms);
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "QuadBatch.h"
+
+struct GLFWwindow;
+
+// The ways the benchmark can draw a scene of rectangles.
+enum DrawPath
+{
+    DRAW_PATH_PER_VAO,   // one VAO and glDrawArrays per rectangle with a program switch, like main() used to do
+    DRAW_PATH_SORTED,    // the same draws through a RenderQueue
+    DRAW_PATH_BATCHED,   // QuadBatch, one glDrawElements
+    DRAW_PATH_INSTANCED, // InstancedRects, one glDrawArraysInstanced
+    DRAW_PATH_INDEXED,   // IndexedMesh with deduplicated, cache optimized vertices
+    DRAW_PATH_REUPLOAD,  // InstancedRects uploading every rectangle again every frame with glBufferSubData
+    DRAW_PATH_STREAMED,  // the same through a StreamBuffer
+    DRAW_PATH_UNIFORMS,  // one draw per rectangle, its rectangle and color set with glUniform4fv
+    DRAW_PATH_UBO_RING,  // the same draws, their constants written into a UniformRing at once and bound by range
+    DRAW_PATH_GROUPS,    // PanelGroups of 100 rectangles, one glDrawElementsInstancedBaseVertex per group
+    DRAW_PATH_MULTI_DRAW, // the same groups with one glMultiDrawElementsIndirect
+    DRAW_PATH_PACKED,    // QuadBatch with 8 byte QUAD_VERTEX_PACKED vertices instead of 24 byte float ones
+    DRAW_PATH_COUNT
+};
+extern const char* const drawPathNames[DRAW_PATH_COUNT];
+
+struct BenchResult
+{
+    double cpuMs;   // time spent issuing GL calls
+    double frameMs; // submission plus waiting for the GPU to finish
+    int frames;     // how many frames the averages are over
+};
+
+// Rectangles of random size and position, the same for every run.
+std::vector<Panel> makeBenchScene(unsigned int count);
+// Averages over up to 60 frames; slow paths stop early after about two seconds.
+BenchResult benchDrawPath(DrawPath path, const std::vector<Panel>& scene);
+
+struct ShaderBuildResult
+{
+    double compileMs; // vertex plus fragment shader
+    double linkMs;
+};
+// Average time to build a program. Every iteration changes the source a little so the driver's shader cache can't help.
+ShaderBuildResult benchShaderBuild(const char* vertexSource, const char* fragmentSource, int iterations);
+
+struct ProgramCacheResult
+{
+    double coldMs; // createProgram() without a saved binary: compile, link and save
+    double warmMs; // createProgram() again, loading the binary the cold run saved
+};
+// Startup cost of one program with and without the program cache. programCache must be enabled.
+ProgramCacheResult benchProgramCache(const char* vertexSource, const char* fragmentSource, int iterations);
+
+enum UploadMethod
+{
+    UPLOAD_BUFFER_DATA,           // glBufferData, the driver allocates new storage every time
+    UPLOAD_BUFFER_SUB_DATA,       // glBufferSubData into the existing storage
+    UPLOAD_ORPHAN,                // glBufferData(NULL) to orphan the old storage, then glBufferSubData
+    UPLOAD_MAP_INVALIDATE,        // glMapBufferRange with GL_MAP_INVALIDATE_BUFFER_BIT and a memcpy
+    UPLOAD_STREAM_PERSISTENT,     // StreamBuffer, a memcpy into the persistently mapped ring
+    UPLOAD_STREAM_UNSYNCHRONIZED, // StreamBuffer without buffer storage: unsynchronized mapping and orphaning
+    UPLOAD_METHOD_COUNT
+};
+extern const char* const uploadMethodNames[UPLOAD_METHOD_COUNT];
+// Megabytes per second for uploading bytes into a vertex buffer, including the wait for the GPU.
+double benchUpload(UploadMethod method, size_t bytes, int iterations);
+
+/*
+Draws scenes of increasingly many rectangles through each draw path and prints the average
+CPU submission time and full frame time (submission + glFinish) per path.
+Started with "Game --bench". Needs a current OpenGL context; vsync is turned off while it runs.
+window may be NULL when running headless, the draws then go to whatever framebuffer is bound.
+The Bench project runs the full suite and writes machine readable results.
+*/
+void runBenchmark(GLFWwindow* window);
+
+/*
+Draws the same scenes with the software rasterizer on 1, 2, 4, ... threads up to one per hardware thread
+and prints the frame time and the speedup over one thread. Needs no OpenGL context.
+Started with "Game --software --bench".
+*/
+void runSoftwareBenchmark();
@@ -0,0 +1,182 @@
+#include "DamageTracker.h"
+#include <algorithm>
+#include <cmath>
+
+// Damage above this share of the screen is repainted in one go.
+const float FULL_REPAINT_FRACTION = 0.6f;
+
+static int area(const PixelRect& r)
+{
+    return r.w * r.h;
+}
+
+static PixelRect unite(const PixelRect& a, const PixelRect& b)
+{
+    int x0 = std::min(a.x, b.x), y0 = std::min(a.y, b.y);
+    int x1 = std::max(a.x + a.w, b.x + b.w), y1 = std::max(a.y + a.h, b.y + b.h);
+    return { x0, y0, x1 - x0, y1 - y0 };
+}
+
+static bool touches(const PixelRect& a, const PixelRect& b)
+{
+    return a.x <= b.x + b.w && b.x <= a.x + a.w && a.y <= b.y + b.h && b.y <= a.y + a.h;
+}
+
+void DamageTracker::resize(int newWidth, int newHeight)
+{
+    if (newWidth == width && newHeight == height)
+        return;
+    width = newWidth;
+    height = newHeight;
+    full = true;
+    // old damage is meaningless at a different size
+    historyFrames = 0;
+}
+
+void DamageTracker::damage(const PixelRect& rect)
+{
+    if (full)
+        return;
+    int x0 = std::max(rect.x, 0), y0 = std::max(rect.y, 0);
+    int x1 = std::min(rect.x + rect.w, width), y1 = std::min(rect.y + rect.h, height);
+    if (x1 <= x0 || y1 <= y0)
+        return;
+    current.push_back({ x0, y0, x1 - x0, y1 - y0 });
+    merge(current, width * height, full);
+}
+
+PixelRect DamageTracker::toPixels(float x, float y, float w, float h) const
+{
+    int x0 = (int)floorf((x + 1.0f) * 0.5f * width);
+    int y0 = (int)floorf((y + 1.0f) * 0.5f * height);
+    int x1 = (int)ceilf((x + w + 1.0f) * 0.5f * width);
+    int y1 = (int)ceilf((y + h + 1.0f) * 0.5f * height);
+    return { x0, y0, x1 - x0, y1 - y0 };
+}
+
+void DamageTracker::damageNDC(float x, float y, float w, float h)
+{
+    damage(toPixels(x, y, w, h));
+}
+
+void DamageTracker::damageUncoveredNDC(const float* rects, unsigned int count, unsigned int stride)
+{
+    if (full)
+        return;
+    // Start with the whole screen and cut every cover out of it, each cut leaves up to 4 pieces.
+    std::vector<PixelRect> uncovered(1, PixelRect{ 0, 0, width, height });
+    std::vector<PixelRect> pieces;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const float* r = rects + i * stride;
+        // round inwards, a partly covered pixel still shows the background
+        int cx0 = (int)ceilf((r[0] + 1.0f) * 0.5f * width);
+        int cy0 = (int)ceilf((r[1] + 1.0f) * 0.5f * height);
+        int cx1 = (int)floorf((r[0] + r[2] + 1.0f) * 0.5f * width);
+        int cy1 = (int)floorf((r[1] + r[3] + 1.0f) * 0.5f * height);
+        if (cx1 <= cx0 || cy1 <= cy0)
+            continue;
+
+        pieces.clear();
+        for (const PixelRect& u : uncovered)
+        {
+            int ux1 = u.x + u.w, uy1 = u.y + u.h;
+            if (cx0 >= ux1 || cx1 <= u.x || cy0 >= uy1 || cy1 <= u.y)
+            {
+                pieces.push_back(u);
+                continue;
+            }
+            int top = std::max(u.y, cy0), bottom = std::min(uy1, cy1);
+            if (u.y < cy0)
+                pieces.push_back({ u.x, u.y, u.w, cy0 - u.y });
+            if (uy1 > cy1)
+                pieces.push_back({ u.x, cy1, u.w, uy1 - cy1 });
+            if (u.x < cx0)
+                pieces.push_back({ u.x, top, cx0 - u.x, bottom - top });
+            if (ux1 > cx1)
+                pieces.push_back({ cx1, top, ux1 - cx1, bottom - top });
+        }
+        uncovered.swap(pieces);
+    }
+    for (const PixelRect& u : uncovered)
+        damage(u);
+}
+
+void DamageTracker::merge(std::vector<PixelRect>& rects, int screenArea, bool& full)
+{
+    // Merge rectangles that touch, as long as that doesn't add much that didn't change.
+    bool merged = true;
+    while (merged)
+    {
+        merged = false;
+        for (size_t i = 0; i < rects.size() && !merged; i++)
+            for (size_t j = i + 1; j < rects.size() && !merged; j++)
+            {
+                PixelRect u = unite(rects[i], rects[j]);
+                if (touches(rects[i], rects[j]) && area(u) <= (area(rects[i]) + area(rects[j])) * 5 / 4)
+                {
+                    rects[i] = u;
+                    rects.erase(rects.begin() + j);
+                    merged = true;
+                }
+            }
+    }
+
+    // Too many rectangles: merge the pair that wastes the fewest pixels until they fit.
+    while (rects.size() > MAX_DAMAGE_RECTS)
+    {
+        size_t bestI = 0, bestJ = 1;
+        long long bestWaste = -1;
+        for (size_t i = 0; i < rects.size(); i++)
+            for (size_t j = i + 1; j < rects.size(); j++)
+            {
+                long long waste = (long long)area(unite(rects[i], rects[j])) - area(rects[i]) - area(rects[j]);
+                if (bestWaste < 0 || waste < bestWaste)
+                {
+                    bestWaste = waste;
+                    bestI = i;
+                    bestJ = j;
+                }
+            }
+        rects[bestI] = unite(rects[bestI], rects[bestJ]);
+        rects.erase(rects.begin() + bestJ);
+    }
+
+    long long total = 0;
+    for (const PixelRect& r : rects)
+        total += area(r);
+    if (total > (long long)(screenArea * FULL_REPAINT_FRACTION))
+    {
+        full = true;
+        rects.clear();
+    }
+}
+
+bool DamageTracker::regionsForBufferAge(unsigned int bufferAge, std::vector<PixelRect>& out) const
+{
+    out.clear();
+    if (full || bufferAge == 0 || bufferAge - 1 > historyFrames)
+        return false;
+
+    // The buffer is missing this frame's damage plus that of the frames drawn since it was last used.
+    out = current;
+    for (unsigned int i = 0; i + 1 < bufferAge; i++)
+        out.insert(out.end(), history[i].begin(), history[i].end());
+    bool repaintAll = false;
+    merge(out, width * height, repaintAll);
+    return !repaintAll;
+}
+
+void DamageTracker::endFrame()
+{
+    for (unsigned int i = DAMAGE_HISTORY - 1; i > 0; i--)
+        history[i].swap(history[i - 1]);
+    if (full)
+        history[0].assign(1, PixelRect{ 0, 0, width, height });
+    else
+        history[0] = current;
+    historyFrames = std::min(historyFrames + 1, DAMAGE_HISTORY);
+
+    current.clear();
+    full = false;
+}
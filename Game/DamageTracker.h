@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+
+// A rectangle in framebuffer pixels, x, y is the bottom left corner like glScissor expects.
+struct PixelRect
+{
+    int x, y, w, h;
+};
+
+const unsigned int MAX_DAMAGE_RECTS = 8;
+// How many frames of damage are remembered for buffer age based presentation.
+const unsigned int DAMAGE_HISTORY = 4;
+
+/*
+Collects the parts of the screen that changed since the last frame.
+Overlapping or nearly adjacent rectangles are merged and the list is kept short, since every rectangle
+costs one scissored clear and redraw. When most of the screen changed it gives up and asks for a full repaint,
+which is cheaper than many scissored passes.
+*/
+class DamageTracker
+{
+public:
+    // Sets the framebuffer size. A size change damages everything.
+    void resize(int width, int height);
+
+    void damageAll() { full = true; }
+    void damage(const PixelRect& rect);
+    // Damages a rectangle given in normalized device coordinates, rounded outwards to whole pixels.
+    void damageNDC(float x, float y, float w, float h);
+    // Damages everything not covered by the given opaque rectangles (NDC x, y, w, h quadruples),
+    // e.g. when only the background color changed.
+    void damageUncoveredNDC(const float* rects, unsigned int count, unsigned int stride);
+
+    bool hasDamage() const { return full || !current.empty(); }
+
+    /*
+    The regions that have to be redrawn for a back buffer whose contents are bufferAge frames old.
+    Age 1 is the frame drawn last (a retained buffer), age 0 means the contents are unknown.
+    Returns false if the whole screen has to be repainted instead.
+    */
+    bool regionsForBufferAge(unsigned int bufferAge, std::vector<PixelRect>& out) const;
+
+    // Moves this frame's damage into the history and starts a new, undamaged frame.
+    void endFrame();
+
+private:
+    PixelRect toPixels(float x, float y, float w, float h) const;
+    static void merge(std::vector<PixelRect>& rects, int screenArea, bool& full);
+
+    int width = 0, height = 0;
+    bool full = true;
+    std::vector<PixelRect> current;
+    // damage of the previous frames, newest first. A frame that was fully repainted is stored as one screen sized rect.
+    std::vector<PixelRect> history[DAMAGE_HISTORY];
+    unsigned int historyFrames = 0;
+};
@@ -0,0 +1,77 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+
+#include "FrameSync.h"
+#include "Profiler.h"
+
+FrameSync frameSync;
+
+void FrameSync::setFramesInFlight(unsigned int framesInFlight)
+{
+    // the contexts are indexed by frame number modulo the count, which is about to change
+    finish();
+    count = std::min(std::max(framesInFlight, 1u), MAX_FRAMES_IN_FLIGHT);
+}
+
+void FrameSync::beginFrame()
+{
+    frame++;
+    stats.frames++;
+    stallMs = 0.0;
+    // still holds the fence of the frame count frames ago
+    wait(contexts[context()]);
+}
+
+void FrameSync::endFrame()
+{
+    FrameContext& current = contexts[context()];
+    if (current.fence)
+        glDeleteSync(current.fence);
+    current.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    current.frame = frame;
+}
+
+void FrameSync::waitForFrame(uint64_t number)
+{
+    for (FrameContext& context : contexts)
+        if (context.fence && context.frame == number)
+            wait(context);
+}
+
+void FrameSync::finish()
+{
+    for (FrameContext& context : contexts)
+        wait(context);
+}
+
+void FrameSync::destroy()
+{
+    for (FrameContext& context : contexts)
+    {
+        if (context.fence)
+            glDeleteSync(context.fence);
+        context = FrameContext();
+    }
+}
+
+void FrameSync::wait(FrameContext& context)
+{
+    if (!context.fence)
+        return;
+    if (glClientWaitSync(context.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+    {
+        PROFILE_ZONE("FrameSync::wait");
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        // flush, or the commands the fence waits for might never reach the GPU
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        while (glClientWaitSync(context.fence, flags, 1000000000ull) == GL_TIMEOUT_EXPIRED)
+            flags = 0;
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        stallMs += ms;
+        stats.stalls++;
+        stats.stallMs += ms;
+    }
+    glDeleteSync(context.fence);
+    context.fence = 0;
+}
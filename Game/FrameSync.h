@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+
+const unsigned int MAX_FRAMES_IN_FLIGHT = 8;
+const unsigned int DEFAULT_FRAMES_IN_FLIGHT = 3;
+
+struct FrameSyncStats
+{
+    uint64_t frames;     // frames begun
+    unsigned int stalls; // waits that actually blocked
+    double stallMs;      // spent in those waits
+};
+
+/*
+Lets the CPU record up to framesInFlight() frames ahead of the GPU, and no further.
+
+Every frame is recorded into one of framesInFlight() frame contexts, in turn. endFrame() puts a fence after
+the frame's last command; when the context comes around again, beginFrame() waits for that fence. Data a
+frame writes for the GPU, like the segments of a StreamBuffer, belongs to its context and is only written
+again once the frame that used it before is done, so the driver never has to stall on a buffer the GPU is
+still reading. Waiting only happens when the CPU laps the GPU, and then in glClientWaitSync where it can be
+measured: the time is added to the frame's stall and shows up in the frame timings.
+*/
+class FrameSync
+{
+public:
+    // 1..MAX_FRAMES_IN_FLIGHT. Waits for every frame in flight first.
+    void setFramesInFlight(unsigned int count);
+    unsigned int framesInFlight() const { return count; }
+
+    // Starts recording the next frame. Call before anything of the frame is written.
+    void beginFrame();
+    // Fences the frame. Call right after its last draw was submitted, before swapping buffers.
+    void endFrame();
+    // The frame being recorded, counting from 1. 0 before the first beginFrame().
+    uint64_t frameNumber() const { return frame; }
+    // Its context, 0..framesInFlight() - 1.
+    unsigned int context() const { return (unsigned int)(frame % count); }
+
+    // Waits until the GPU finished an earlier frame, if it hasn't yet. Frames whose context was reused since
+    // are known to be done.
+    void waitForFrame(uint64_t number);
+    // Waits for every frame in flight.
+    void finish();
+    // Deletes the fences, while the context is still current.
+    void destroy();
+
+    // Time spent waiting during the current frame.
+    double frameStallMs() const { return stallMs; }
+    const FrameSyncStats& getStats() const { return stats; }
+
+private:
+    struct FrameContext
+    {
+        GLsync fence = 0;
+        uint64_t frame = 0;
+    };
+
+    void wait(FrameContext& context);
+
+    FrameContext contexts[MAX_FRAMES_IN_FLIGHT];
+    unsigned int count = DEFAULT_FRAMES_IN_FLIGHT;
+    uint64_t frame = 0;
+    double stallMs = 0.0;
+    FrameSyncStats stats = FrameSyncStats();
+};
+
+extern FrameSync frameSync;
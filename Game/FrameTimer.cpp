@@ -0,0 +1,283 @@
+#include "FrameTimer.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+static const char* metricNames[FRAME_METRIC_COUNT] = {
+    "events", "update", "submit", "swap", "stall", "cpu", "gpu", "gpu_interval"
+};
+
+void FrameTimer::init(bool gpuQueries, bool keepAllFrames)
+{
+    gpu = gpuQueries;
+    keepAll = keepAllFrames;
+    if (gpu)
+        for (QuerySlot& s : slots)
+        {
+            glGenQueries(1, &s.elapsed);
+            glGenQueries(1, &s.timestamp);
+        }
+    samples.clear();
+    if (!keepAll)
+        samples.reserve(TIMER_ROLLING_FRAMES);
+    frameNumber = 0;
+}
+
+void FrameTimer::destroy()
+{
+    if (gpu)
+        for (QuerySlot& s : slots)
+        {
+            glDeleteQueries(1, &s.elapsed);
+            glDeleteQueries(1, &s.timestamp);
+            s = QuerySlot();
+        }
+    gpu = false;
+}
+
+void FrameTimer::beginFrame()
+{
+    current.frame = frameNumber;
+    for (float& ms : current.ms)
+        ms = -1.0f;
+    current.gpuTimestamp = 0;
+    frameStart = Clock::now();
+    inFrame = true;
+}
+
+void FrameTimer::discardFrame()
+{
+    // only valid before beginGpu(), a running query belongs to a frame that is going to be recorded
+    inFrame = false;
+}
+
+void FrameTimer::begin(FrameMetric phase)
+{
+    phaseStart[phase] = Clock::now();
+}
+
+void FrameTimer::end(FrameMetric phase)
+{
+    Clock::time_point now = Clock::now();
+    float ms = std::chrono::duration<float, std::milli>(now - phaseStart[phase]).count();
+    // every phase also shows up as a zone in the profiler's trace
+    if (profiler.isEnabled())
+    {
+        uint64_t endNs = profiler.now();
+        uint64_t lengthNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - phaseStart[phase]).count();
+        profiler.record(metricNames[phase], endNs > lengthNs ? endNs - lengthNs : 0, endNs);
+    }
+    // a phase may run more than once per frame
+    current.ms[phase] = std::max(current.ms[phase], 0.0f) + ms;
+}
+
+void FrameTimer::add(FrameMetric metric, double ms)
+{
+    current.ms[metric] = std::max(current.ms[metric], 0.0f) + (float)ms;
+}
+
+void FrameTimer::beginGpu()
+{
+    QuerySlot& s = slots[slot];
+    // Still waiting for the results from TIMER_QUERY_FRAMES frames ago; skip rather than stall.
+    if (!gpu || s.elapsedPending || s.timestampPending)
+        return;
+    glBeginQuery(GL_TIME_ELAPSED, s.elapsed);
+    s.frame = frameNumber;
+    gpuActive = true;
+}
+
+void FrameTimer::endGpu()
+{
+    if (!gpuActive)
+        return;
+    glEndQuery(GL_TIME_ELAPSED);
+    slots[slot].elapsedPending = true;
+}
+
+void FrameTimer::endFrame()
+{
+    if (!inFrame)
+        return;
+    inFrame = false;
+    if (gpuActive)
+    {
+        glQueryCounter(slots[slot].timestamp, GL_TIMESTAMP);
+        slots[slot].timestampPending = true;
+        gpuActive = false;
+    }
+    Clock::time_point now = Clock::now();
+    current.ms[FRAME_CPU_TOTAL] = std::chrono::duration<float, std::milli>(now - frameStart).count();
+    if (profiler.isEnabled())
+    {
+        uint64_t endNs = profiler.now();
+        uint64_t lengthNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - frameStart).count();
+        profiler.record("frame", endNs > lengthNs ? endNs - lengthNs : 0, endNs);
+    }
+    if (keepAll || samples.size() < TIMER_ROLLING_FRAMES)
+        samples.push_back(current);
+    else
+        samples[frameNumber % TIMER_ROLLING_FRAMES] = current;
+    frameNumber++;
+
+    if (gpu)
+    {
+        collectQueries();
+        slot = (slot + 1) % TIMER_QUERY_FRAMES;
+    }
+}
+
+void FrameTimer::collectQueries()
+{
+    for (QuerySlot& s : slots)
+    {
+        GLint available = 0;
+        if (s.elapsedPending)
+        {
+            glGetQueryObjectiv(s.elapsed, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                GLuint64 ns = 0;
+                glGetQueryObjectui64v(s.elapsed, GL_QUERY_RESULT, &ns);
+                if (FrameSample* measured = sample(s.frame))
+                    measured->ms[FRAME_GPU] = ns / 1000000.0f;
+                s.elapsedPending = false;
+            }
+        }
+        if (s.timestampPending)
+        {
+            glGetQueryObjectiv(s.timestamp, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                GLuint64 ns = 0;
+                glGetQueryObjectui64v(s.timestamp, GL_QUERY_RESULT, &ns);
+                s.timestampPending = false;
+                FrameSample* measured = sample(s.frame);
+                if (!measured)
+                    continue;
+                measured->gpuTimestamp = ns;
+
+                // the slots are not visited in frame order, so the neighbour may have arrived first
+                FrameSample* previous = s.frame > 0 ? sample(s.frame - 1) : nullptr;
+                FrameSample* next = sample(s.frame + 1);
+                if (previous && previous->gpuTimestamp)
+                    measured->ms[FRAME_GPU_INTERVAL] = (measured->gpuTimestamp - previous->gpuTimestamp) / 1000000.0f;
+                if (next && next->gpuTimestamp)
+                    next->ms[FRAME_GPU_INTERVAL] = (next->gpuTimestamp - measured->gpuTimestamp) / 1000000.0f;
+            }
+        }
+    }
+}
+
+unsigned int FrameTimer::firstKept() const
+{
+    return keepAll || frameNumber < TIMER_ROLLING_FRAMES ? 0 : frameNumber - TIMER_ROLLING_FRAMES;
+}
+
+FrameSample* FrameTimer::sample(unsigned int frame)
+{
+    if (frame < firstKept() || frame >= frameNumber)
+        return nullptr;
+    return &samples[keepAll ? frame : frame % TIMER_ROLLING_FRAMES];
+}
+
+const FrameSample& FrameTimer::keptSample(unsigned int frame) const
+{
+    return samples[keepAll ? frame : frame % TIMER_ROLLING_FRAMES];
+}
+
+FramePercentiles FrameTimer::percentiles(FrameMetric metric, bool wholeRun) const
+{
+    unsigned int first = wholeRun || frameNumber < TIMER_ROLLING_FRAMES ? firstKept() : frameNumber - TIMER_ROLLING_FRAMES;
+    std::vector<float> values;
+    values.reserve(frameNumber - first);
+    for (unsigned int frame = first; frame < frameNumber; frame++)
+        if (keptSample(frame).ms[metric] >= 0.0f)
+            values.push_back(keptSample(frame).ms[metric]);
+    if (values.empty())
+        return { -1.0f, -1.0f, -1.0f };
+
+    // nearest rank
+    std::sort(values.begin(), values.end());
+    auto rank = [&](float p) {
+        size_t index = (size_t)std::ceil(p * values.size());
+        return values[std::min(std::max(index, (size_t)1), values.size()) - 1];
+    };
+    return { rank(0.50f), rank(0.95f), rank(0.99f) };
+}
+
+void FrameTimer::printSummary() const
+{
+    printf("%-14s %10s %10s %10s   (ms, last %u frames)\n", "phase", "p50", "p95", "p99", TIMER_ROLLING_FRAMES);
+    for (int m = 0; m < FRAME_METRIC_COUNT; m++)
+    {
+        FramePercentiles p = percentiles((FrameMetric)m);
+        if (p.p50 >= 0.0f)
+            printf("%-14s %10.3f %10.3f %10.3f\n", metricNames[m], p.p50, p.p95, p.p99);
+    }
+}
+
+bool FrameTimer::exportCSV(const char* path) const
+{
+    FILE* file = fopen(path, "w");
+    if (!file)
+    {
+        std::cout << "ERROR::FRAME_TIMER::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+    fprintf(file, "frame");
+    for (int m = 0; m < FRAME_METRIC_COUNT; m++)
+        fprintf(file, ",%s_ms", metricNames[m]);
+    fprintf(file, "\n");
+    for (unsigned int frame = firstKept(); frame < frameNumber; frame++)
+    {
+        const FrameSample& sample = keptSample(frame);
+        fprintf(file, "%u", sample.frame);
+        for (int m = 0; m < FRAME_METRIC_COUNT; m++)
+            if (sample.ms[m] >= 0.0f)
+                fprintf(file, ",%.4f", sample.ms[m]);
+            else
+                fprintf(file, ",");
+        fprintf(file, "\n");
+    }
+    fclose(file);
+    return true;
+}
+
+bool FrameTimer::exportJSON(const char* path) const
+{
+    FILE* file = fopen(path, "w");
+    if (!file)
+    {
+        std::cout << "ERROR::FRAME_TIMER::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+    fprintf(file, "{\n  \"percentiles\": {");
+    bool firstMetric = true;
+    for (int m = 0; m < FRAME_METRIC_COUNT; m++)
+    {
+        FramePercentiles p = percentiles((FrameMetric)m, true);
+        if (p.p50 < 0.0f)
+            continue;
+        fprintf(file, "%s\n    \"%s\": { \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f }",
+            firstMetric ? "" : ",", metricNames[m], p.p50, p.p95, p.p99);
+        firstMetric = false;
+    }
+    fprintf(file, "\n  },\n  \"frames\": [");
+    for (unsigned int frame = firstKept(); frame < frameNumber; frame++)
+    {
+        const FrameSample& sample = keptSample(frame);
+        fprintf(file, "%s\n    { \"frame\": %u", frame > firstKept() ? "," : "", sample.frame);
+        for (int m = 0; m < FRAME_METRIC_COUNT; m++)
+            if (sample.ms[m] >= 0.0f)
+                fprintf(file, ", \"%s\": %.4f", metricNames[m], sample.ms[m]);
+            else
+                fprintf(file, ", \"%s\": null", metricNames[m]);
+        fprintf(file, " }");
+    }
+    fprintf(file, "\n  ]\n}\n");
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+enum FrameMetric
+{
+    FRAME_EVENTS,       // redraw.waitForEvents(), includes sleeping until the next event unless --continuous
+    FRAME_UPDATE,       // getting the scene ready: sizes, damage, materials, layer cache
+    FRAME_SUBMIT,       // issuing the GL calls of the frame
+    FRAME_SWAP,         // glfwSwapBuffers, includes waiting for vsync
+    FRAME_STALL,        // waiting in glClientWaitSync for the GPU to finish a frame context, within the phases above
+    FRAME_CPU_TOTAL,    // beginFrame() to endFrame()
+    FRAME_GPU,          // GPU time of the submitted work, from a GL_TIME_ELAPSED query
+    FRAME_GPU_INTERVAL, // GL_TIMESTAMP at the end of this frame minus the one at the end of the previous frame
+    FRAME_METRIC_COUNT
+};
+
+// How many frames of GPU queries are in flight. Results are read this many frames late, so reading them never stalls.
+const unsigned int TIMER_QUERY_FRAMES = 4;
+// The live percentiles look at this many of the most recent frames.
+const unsigned int TIMER_ROLLING_FRAMES = 256;
+
+struct FrameSample
+{
+    unsigned int frame;
+    float ms[FRAME_METRIC_COUNT]; // negative while (or if) the value is not known
+    uint64_t gpuTimestamp;        // nanoseconds, 0 until the query result is back
+};
+
+struct FramePercentiles
+{
+    float p50, p95, p99;
+};
+
+/*
+Measures where the time of every frame goes.
+CPU phases are timed with std::chrono between begin() and end(). The GPU side uses a ring of
+GL_TIME_ELAPSED and GL_TIMESTAMP queries, one set per frame; endFrame() picks up whichever results are
+available without waiting. If a ring slot comes around again before its results are back, that frame
+simply gets no GPU timing.
+With keepAllFrames every recorded frame is kept so a whole run can be exported to CSV or JSON. Otherwise only
+the last TIMER_ROLLING_FRAMES are, in a ring, so a window left open for days doesn't keep growing.
+*/
+class FrameTimer
+{
+public:
+    // With gpuQueries false only CPU times are recorded, e.g. for the software rasterizer.
+    // keepAllFrames is for runs that are exported afterwards.
+    void init(bool gpuQueries = true, bool keepAllFrames = false);
+    void destroy();
+
+    void beginFrame();
+    // Forgets the frame started with beginFrame(), e.g. when nothing needed to be redrawn.
+    void discardFrame();
+    void endFrame();
+
+    void begin(FrameMetric phase);
+    void end(FrameMetric phase);
+    // Adds time measured elsewhere, e.g. frameSync's stall.
+    void add(FrameMetric metric, double ms);
+    // Bracket the GL calls of the frame. Only one pair per frame.
+    void beginGpu();
+    void endGpu();
+
+    // Percentile over the last TIMER_ROLLING_FRAMES frames, or every frame kept. Frames without the metric are skipped.
+    FramePercentiles percentiles(FrameMetric metric, bool wholeRun = false) const;
+
+    // Prints p50/p95/p99 of every metric over the rolling window.
+    void printSummary() const;
+    // One line per frame kept. Unknown values are left empty.
+    bool exportCSV(const char* path) const;
+    // Every frame kept plus their percentiles.
+    bool exportJSON(const char* path) const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct QuerySlot
+    {
+        unsigned int elapsed = 0, timestamp = 0;
+        unsigned int frame = 0; // number of the frame the queries measure
+        bool elapsedPending = false, timestampPending = false;
+    };
+
+    void collectQueries();
+    // The oldest frame still kept.
+    unsigned int firstKept() const;
+    // A kept frame by its number, null once the ring has overwritten it.
+    FrameSample* sample(unsigned int frame);
+    const FrameSample& keptSample(unsigned int frame) const;
+
+    bool gpu = false;
+    QuerySlot slots[TIMER_QUERY_FRAMES];
+    unsigned int slot = 0;
+    bool gpuActive = false;
+
+    FrameSample current;
+    Clock::time_point frameStart;
+    Clock::time_point phaseStart[FRAME_METRIC_COUNT];
+    bool inFrame = false;
+    unsigned int frameNumber = 0;
+    bool keepAll = false;
+    std::vector<FrameSample> samples; // frame n at n, or at n % TIMER_ROLLING_FRAMES in the ring
+};
@@ -0,0 +1,116 @@
+#include "GLExtensions.h"
+#include <cstring>
+
+GLExtensions glExt;
+
+void GLExtensions::load(GLADloadproc loader)
+{
+    *this = GLExtensions();
+    glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+    glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+
+    bool binaryEntryPoints = versionAtLeast(4, 1) || hasExtension("GL_ARB_get_program_binary");
+    bool separateEntryPoints = versionAtLeast(4, 1) || hasExtension("GL_ARB_separate_shader_objects");
+    // both of them bring glProgramParameteri
+    if (binaryEntryPoints || separateEntryPoints)
+        programParameteri = (ProgramParameteriProc)loader("glProgramParameteri");
+
+    if (binaryEntryPoints)
+    {
+        getProgramBinary = (GetProgramBinaryProc)loader("glGetProgramBinary");
+        programBinaryLoad = (ProgramBinaryProc)loader("glProgramBinary");
+        // a driver may support the extension without offering any format to save in
+        int formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        programBinary = getProgramBinary && programBinaryLoad && programParameteri && formats > 0;
+    }
+    if (!programBinary)
+    {
+        getProgramBinary = nullptr;
+        programBinaryLoad = nullptr;
+    }
+
+    if (separateEntryPoints)
+    {
+        genProgramPipelines = (GenProgramPipelinesProc)loader("glGenProgramPipelines");
+        deleteProgramPipelines = (DeleteProgramPipelinesProc)loader("glDeleteProgramPipelines");
+        bindProgramPipeline = (BindProgramPipelineProc)loader("glBindProgramPipeline");
+        useProgramStages = (UseProgramStagesProc)loader("glUseProgramStages");
+        separateShaderObjects = genProgramPipelines && deleteProgramPipelines && bindProgramPipeline
+            && useProgramStages && programParameteri;
+    }
+    if (!separateShaderObjects)
+    {
+        genProgramPipelines = nullptr;
+        deleteProgramPipelines = nullptr;
+        bindProgramPipeline = nullptr;
+        useProgramStages = nullptr;
+    }
+    if (!programBinary && !separateShaderObjects)
+        programParameteri = nullptr;
+
+    if (versionAtLeast(4, 4) || hasExtension("GL_ARB_buffer_storage"))
+        bufferStorageCreate = (BufferStorageProc)loader("glBufferStorage");
+    bufferStorage = bufferStorageCreate != nullptr;
+
+    if (versionAtLeast(4, 5) || hasExtension("GL_ARB_direct_state_access"))
+    {
+        createBuffers = (CreateBuffersProc)loader("glCreateBuffers");
+        namedBufferStorage = (NamedBufferStorageProc)loader("glNamedBufferStorage");
+        namedBufferSubData = (NamedBufferSubDataProc)loader("glNamedBufferSubData");
+        createVertexArrays = (CreateVertexArraysProc)loader("glCreateVertexArrays");
+        vertexArrayVertexBuffer = (VertexArrayVertexBufferProc)loader("glVertexArrayVertexBuffer");
+        vertexArrayElementBuffer = (VertexArrayElementBufferProc)loader("glVertexArrayElementBuffer");
+        vertexArrayAttribFormat = (VertexArrayAttribFormatProc)loader("glVertexArrayAttribFormat");
+        vertexArrayAttribIFormat = (VertexArrayAttribIFormatProc)loader("glVertexArrayAttribIFormat");
+        vertexArrayAttribBinding = (VertexArrayAttribBindingProc)loader("glVertexArrayAttribBinding");
+        vertexArrayBindingDivisor = (VertexArrayBindingDivisorProc)loader("glVertexArrayBindingDivisor");
+        enableVertexArrayAttrib = (EnableVertexArrayAttribProc)loader("glEnableVertexArrayAttrib");
+        directStateAccess = createBuffers && namedBufferStorage && namedBufferSubData && createVertexArrays
+            && vertexArrayVertexBuffer && vertexArrayElementBuffer && vertexArrayAttribFormat && vertexArrayAttribIFormat
+            && vertexArrayAttribBinding && vertexArrayBindingDivisor && enableVertexArrayAttrib;
+    }
+    if (!directStateAccess)
+    {
+        createBuffers = nullptr;
+        namedBufferStorage = nullptr;
+        namedBufferSubData = nullptr;
+        createVertexArrays = nullptr;
+        vertexArrayVertexBuffer = nullptr;
+        vertexArrayElementBuffer = nullptr;
+        vertexArrayAttribFormat = nullptr;
+        vertexArrayAttribIFormat = nullptr;
+        vertexArrayAttribBinding = nullptr;
+        vertexArrayBindingDivisor = nullptr;
+        enableVertexArrayAttrib = nullptr;
+    }
+
+    // a base instance other than 0 in the indirect commands needs ARB_base_instance
+    if (versionAtLeast(4, 3) || (hasExtension("GL_ARB_multi_draw_indirect") && hasExtension("GL_ARB_base_instance")))
+        multiDrawElementsIndirect = (MultiDrawElementsIndirectProc)loader("glMultiDrawElementsIndirect");
+    multiDrawIndirect = multiDrawElementsIndirect != nullptr;
+
+    if (hasExtension("GL_KHR_parallel_shader_compile"))
+        maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)loader("glMaxShaderCompilerThreadsKHR");
+    else if (hasExtension("GL_ARB_parallel_shader_compile"))
+        maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)loader("glMaxShaderCompilerThreadsARB");
+    parallelShaderCompile = maxShaderCompilerThreads != nullptr;
+}
+
+bool GLExtensions::hasExtension(const char* name) const
+{
+    int count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (int i = 0; i < count; i++)
+    {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool GLExtensions::versionAtLeast(int major, int minor) const
+{
+    return majorVersion > major || (majorVersion == major && minorVersion >= minor);
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Enums newer than OpenGL 3.3, which glad was generated for.
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_PROGRAM_SEPARABLE
+#define GL_PROGRAM_SEPARABLE 0x8258
+#endif
+#ifndef GL_VERTEX_SHADER_BIT
+#define GL_VERTEX_SHADER_BIT 0x00000001
+#endif
+#ifndef GL_FRAGMENT_SHADER_BIT
+#define GL_FRAGMENT_SHADER_BIT 0x00000002
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_DYNAMIC_STORAGE_BIT
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+/*
+Entry points from newer OpenGL versions and extensions, loaded by hand after glad.
+The window asks for a 3.3 core context, but most drivers hand out a newer one anyway, so the
+features are used whenever they are there and every user keeps a 3.3 path for when they are not.
+A function pointer is only set if its feature flag is true.
+*/
+struct GLExtensions
+{
+    typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+    typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+    typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+    typedef void (APIENTRYP GenProgramPipelinesProc)(GLsizei n, GLuint* pipelines);
+    typedef void (APIENTRYP DeleteProgramPipelinesProc)(GLsizei n, const GLuint* pipelines);
+    typedef void (APIENTRYP BindProgramPipelineProc)(GLuint pipeline);
+    typedef void (APIENTRYP UseProgramStagesProc)(GLuint pipeline, GLbitfield stages, GLuint program);
+    typedef void (APIENTRYP BufferStorageProc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+    typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+    typedef void (APIENTRYP MultiDrawElementsIndirectProc)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+    typedef void (APIENTRYP CreateBuffersProc)(GLsizei n, GLuint* buffers);
+    typedef void (APIENTRYP NamedBufferStorageProc)(GLuint buffer, GLsizeiptr size, const void* data, GLbitfield flags);
+    typedef void (APIENTRYP NamedBufferSubDataProc)(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data);
+    typedef void (APIENTRYP CreateVertexArraysProc)(GLsizei n, GLuint* arrays);
+    typedef void (APIENTRYP VertexArrayVertexBufferProc)(GLuint vaobj, GLuint bindingindex, GLuint buffer, GLintptr offset, GLsizei stride);
+    typedef void (APIENTRYP VertexArrayElementBufferProc)(GLuint vaobj, GLuint buffer);
+    typedef void (APIENTRYP VertexArrayAttribFormatProc)(GLuint vaobj, GLuint attribindex, GLint size, GLenum type, GLboolean normalized, GLuint relativeoffset);
+    typedef void (APIENTRYP VertexArrayAttribIFormatProc)(GLuint vaobj, GLuint attribindex, GLint size, GLenum type, GLuint relativeoffset);
+    typedef void (APIENTRYP VertexArrayAttribBindingProc)(GLuint vaobj, GLuint attribindex, GLuint bindingindex);
+    typedef void (APIENTRYP VertexArrayBindingDivisorProc)(GLuint vaobj, GLuint bindingindex, GLuint divisor);
+    typedef void (APIENTRYP EnableVertexArrayAttribProc)(GLuint vaobj, GLuint index);
+
+    // Call once the context is current and glad is loaded, with the same loader glad got.
+    void load(GLADloadproc loader);
+    bool hasExtension(const char* name) const;
+    bool versionAtLeast(int major, int minor) const;
+
+    int majorVersion = 0, minorVersion = 0;
+
+    // OpenGL 4.1 or ARB_get_program_binary, and at least one binary format
+    bool programBinary = false;
+    GetProgramBinaryProc getProgramBinary = nullptr;
+    ProgramBinaryProc programBinaryLoad = nullptr;
+    // set if programBinary or separateShaderObjects is
+    ProgramParameteriProc programParameteri = nullptr;
+
+    // OpenGL 4.1 or ARB_separate_shader_objects: programs with a single stage, combined in program pipelines
+    bool separateShaderObjects = false;
+    GenProgramPipelinesProc genProgramPipelines = nullptr;
+    DeleteProgramPipelinesProc deleteProgramPipelines = nullptr;
+    BindProgramPipelineProc bindProgramPipeline = nullptr;
+    UseProgramStagesProc useProgramStages = nullptr;
+
+    // OpenGL 4.4 or ARB_buffer_storage: immutable buffers that can stay mapped while the GPU reads them
+    bool bufferStorage = false;
+    BufferStorageProc bufferStorageCreate = nullptr;
+
+    // OpenGL 4.5 or ARB_direct_state_access: buffers and vertex arrays edited by name, without binding them
+    bool directStateAccess = false;
+    CreateBuffersProc createBuffers = nullptr;
+    NamedBufferStorageProc namedBufferStorage = nullptr;
+    NamedBufferSubDataProc namedBufferSubData = nullptr;
+    CreateVertexArraysProc createVertexArrays = nullptr;
+    VertexArrayVertexBufferProc vertexArrayVertexBuffer = nullptr;
+    VertexArrayElementBufferProc vertexArrayElementBuffer = nullptr;
+    VertexArrayAttribFormatProc vertexArrayAttribFormat = nullptr;
+    VertexArrayAttribIFormatProc vertexArrayAttribIFormat = nullptr;
+    VertexArrayAttribBindingProc vertexArrayAttribBinding = nullptr;
+    VertexArrayBindingDivisorProc vertexArrayBindingDivisor = nullptr;
+    EnableVertexArrayAttribProc enableVertexArrayAttrib = nullptr;
+
+    // OpenGL 4.3, or ARB_multi_draw_indirect with ARB_base_instance: many indexed draws read from a
+    // GL_DRAW_INDIRECT_BUFFER in one call, each with its own base instance
+    bool multiDrawIndirect = false;
+    MultiDrawElementsIndirectProc multiDrawElementsIndirect = nullptr;
+
+    // KHR_parallel_shader_compile or ARB_parallel_shader_compile: GL_COMPLETION_STATUS_KHR can be queried
+    // without waiting for the compiler
+    bool parallelShaderCompile = false;
+    MaxShaderCompilerThreadsProc maxShaderCompilerThreads = nullptr;
+};
+
+extern GLExtensions glExt;
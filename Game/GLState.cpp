@@ -0,0 +1,327 @@
+#include "GLState.h"
+#include "GLExtensions.h"
+
+GLStateCache glState;
+
+void GLStateCache::invalidate()
+{
+    program = ~0u;
+    programPipeline = ~0u;
+    vertexArray = ~0u;
+    arrayBuffer = ~0u;
+    elementBuffer = ~0u;
+    uniformBuffer = ~0u;
+    for (unsigned int i = 0; i < MAX_UNIFORM_BINDINGS; i++)
+    {
+        uniformBindings[i] = ~0u;
+        uniformOffsets[i] = uniformSizes[i] = 0;
+    }
+    activeTexture = ~0u;
+    for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++)
+        textures[i] = ~0u;
+    readFramebuffer = ~0u;
+    drawFramebuffer = ~0u;
+    blend = ~0u;
+    blendSource = blendDestination = ~0u;
+    scissorTest = ~0u;
+    for (int i = 0; i < 4; i++)
+    {
+        scissorBox[i] = -1;
+        viewportBox[i] = -1;
+        clear[i] = -1.0f;
+    }
+}
+
+void GLStateCache::beginFrame()
+{
+    previous = current;
+    current.issued = 0;
+    current.filtered = 0;
+}
+
+bool GLStateCache::changed(unsigned int& cached, unsigned int value)
+{
+    if (cached == value)
+    {
+        current.filtered++;
+        return false;
+    }
+    cached = value;
+    current.issued++;
+    return true;
+}
+
+void GLStateCache::useProgram(unsigned int id)
+{
+    if (changed(program, id))
+        glUseProgram(id);
+}
+
+void GLStateCache::bindProgramPipeline(unsigned int pipeline)
+{
+    useProgram(0);
+    if (changed(programPipeline, pipeline))
+        glExt.bindProgramPipeline(pipeline);
+}
+
+void GLStateCache::bindVertexArray(unsigned int vao)
+{
+    if (changed(vertexArray, vao))
+    {
+        glBindVertexArray(vao);
+        // each VAO remembers its own element buffer
+        elementBuffer = ~0u;
+    }
+}
+
+void GLStateCache::bindBuffer(GLenum target, unsigned int buffer)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER:
+        if (changed(arrayBuffer, buffer))
+            glBindBuffer(target, buffer);
+        break;
+    case GL_ELEMENT_ARRAY_BUFFER:
+        if (changed(elementBuffer, buffer))
+            glBindBuffer(target, buffer);
+        break;
+    case GL_UNIFORM_BUFFER:
+        if (changed(uniformBuffer, buffer))
+            glBindBuffer(target, buffer);
+        break;
+    default:
+        current.issued++;
+        glBindBuffer(target, buffer);
+        break;
+    }
+}
+
+void GLStateCache::bindBufferBase(GLenum target, unsigned int index, unsigned int buffer)
+{
+    if (target != GL_UNIFORM_BUFFER || index >= MAX_UNIFORM_BINDINGS)
+    {
+        current.issued++;
+        glBindBufferBase(target, index, buffer);
+        return;
+    }
+    // a range bound before has to be replaced by the whole buffer even if the buffer is the same
+    if (uniformSizes[index] != 0)
+        uniformBindings[index] = ~0u;
+    if (changed(uniformBindings[index], buffer))
+    {
+        glBindBufferBase(target, index, buffer);
+        // glBindBufferBase also binds the buffer to the generic GL_UNIFORM_BUFFER target
+        uniformBuffer = buffer;
+        uniformOffsets[index] = uniformSizes[index] = 0;
+    }
+}
+
+void GLStateCache::bindBufferRange(GLenum target, unsigned int index, unsigned int buffer, size_t offset, size_t size)
+{
+    if (target != GL_UNIFORM_BUFFER || index >= MAX_UNIFORM_BINDINGS)
+    {
+        current.issued++;
+        glBindBufferRange(target, index, buffer, offset, size);
+        return;
+    }
+    if (uniformBindings[index] == buffer && uniformOffsets[index] == offset && uniformSizes[index] == size)
+    {
+        current.filtered++;
+        return;
+    }
+    current.issued++;
+    glBindBufferRange(target, index, buffer, offset, size);
+    uniformBindings[index] = buffer;
+    uniformOffsets[index] = offset;
+    uniformSizes[index] = size;
+    // like glBindBufferBase, this binds the generic target as well
+    uniformBuffer = buffer;
+}
+
+void GLStateCache::bindTexture(unsigned int unit, unsigned int texture)
+{
+    if (unit >= MAX_TEXTURE_UNITS)
+        return;
+    if (textures[unit] == texture)
+    {
+        current.filtered++;
+        return;
+    }
+    if (changed(activeTexture, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+    textures[unit] = texture;
+    current.issued++;
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void GLStateCache::bindFramebuffer(unsigned int id)
+{
+    if (readFramebuffer == id && drawFramebuffer == id)
+    {
+        current.filtered++;
+        return;
+    }
+    readFramebuffer = drawFramebuffer = id;
+    current.issued++;
+    glBindFramebuffer(GL_FRAMEBUFFER, id);
+}
+
+void GLStateCache::bindReadFramebuffer(unsigned int id)
+{
+    if (changed(readFramebuffer, id))
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, id);
+}
+
+void GLStateCache::bindDrawFramebuffer(unsigned int id)
+{
+    if (changed(drawFramebuffer, id))
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, id);
+}
+
+void GLStateCache::setBlend(bool enabled)
+{
+    if (changed(blend, enabled ? 1u : 0u))
+    {
+        if (enabled)
+            glEnable(GL_BLEND);
+        else
+            glDisable(GL_BLEND);
+    }
+}
+
+void GLStateCache::blendFunc(GLenum source, GLenum destination)
+{
+    if (blendSource == source && blendDestination == destination)
+    {
+        current.filtered++;
+        return;
+    }
+    blendSource = source;
+    blendDestination = destination;
+    current.issued++;
+    glBlendFunc(source, destination);
+}
+
+void GLStateCache::setScissorTest(bool enabled)
+{
+    if (changed(scissorTest, enabled ? 1u : 0u))
+    {
+        if (enabled)
+            glEnable(GL_SCISSOR_TEST);
+        else
+            glDisable(GL_SCISSOR_TEST);
+    }
+}
+
+void GLStateCache::scissor(int x, int y, int width, int height)
+{
+    if (scissorBox[0] == x && scissorBox[1] == y && scissorBox[2] == width && scissorBox[3] == height)
+    {
+        current.filtered++;
+        return;
+    }
+    scissorBox[0] = x;
+    scissorBox[1] = y;
+    scissorBox[2] = width;
+    scissorBox[3] = height;
+    current.issued++;
+    glScissor(x, y, width, height);
+}
+
+void GLStateCache::viewport(int x, int y, int width, int height)
+{
+    if (viewportBox[0] == x && viewportBox[1] == y && viewportBox[2] == width && viewportBox[3] == height)
+    {
+        current.filtered++;
+        return;
+    }
+    viewportBox[0] = x;
+    viewportBox[1] = y;
+    viewportBox[2] = width;
+    viewportBox[3] = height;
+    current.issued++;
+    glViewport(x, y, width, height);
+}
+
+bool GLStateCache::getViewport(int out[4]) const
+{
+    if (viewportBox[2] < 0)
+        return false;
+    for (int i = 0; i < 4; i++)
+        out[i] = viewportBox[i];
+    return true;
+}
+
+void GLStateCache::clearColor(float r, float g, float b, float a)
+{
+    if (clear[0] == r && clear[1] == g && clear[2] == b && clear[3] == a)
+    {
+        current.filtered++;
+        return;
+    }
+    clear[0] = r;
+    clear[1] = g;
+    clear[2] = b;
+    clear[3] = a;
+    current.issued++;
+    glClearColor(r, g, b, a);
+}
+
+void GLStateCache::deleteProgram(unsigned int id)
+{
+    if (program == id)
+        program = ~0u;
+    glDeleteProgram(id);
+}
+
+void GLStateCache::deleteProgramPipeline(unsigned int pipeline)
+{
+    if (programPipeline == pipeline)
+        programPipeline = ~0u;
+    glExt.deleteProgramPipelines(1, &pipeline);
+}
+
+void GLStateCache::deleteVertexArray(unsigned int vao)
+{
+    // deleting the bound VAO binds VAO 0 (and with it VAO 0's element buffer)
+    if (vertexArray == vao)
+    {
+        vertexArray = 0;
+        elementBuffer = ~0u;
+    }
+    glDeleteVertexArrays(1, &vao);
+}
+
+void GLStateCache::deleteBuffer(unsigned int buffer)
+{
+    // deleting a bound buffer resets that binding to 0
+    if (arrayBuffer == buffer)
+        arrayBuffer = 0;
+    if (elementBuffer == buffer)
+        elementBuffer = 0;
+    if (uniformBuffer == buffer)
+        uniformBuffer = 0;
+    // indexed bindings keep pointing at the dead buffer until rebound, just make sure we rebind
+    for (unsigned int i = 0; i < MAX_UNIFORM_BINDINGS; i++)
+        if (uniformBindings[i] == buffer)
+            uniformBindings[i] = ~0u;
+    glDeleteBuffers(1, &buffer);
+}
+
+void GLStateCache::deleteTexture(unsigned int texture)
+{
+    for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++)
+        if (textures[i] == texture)
+            textures[i] = 0;
+    glDeleteTextures(1, &texture);
+}
+
+void GLStateCache::deleteFramebuffer(unsigned int id)
+{
+    if (readFramebuffer == id)
+        readFramebuffer = 0;
+    if (drawFramebuffer == id)
+        drawFramebuffer = 0;
+    glDeleteFramebuffers(1, &id);
+}
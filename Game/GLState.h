@@ -0,0 +1,104 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+
+const unsigned int MAX_TEXTURE_UNITS = 16;
+const unsigned int MAX_UNIFORM_BINDINGS = 16;
+
+struct GLStateStats
+{
+    unsigned int issued;   // state changes that reached the driver
+    unsigned int filtered; // state changes dropped because the state was already set
+};
+
+/*
+Remembers the OpenGL state we set last and drops calls that would set it to the same value again.
+Every draw path goes through glState instead of calling glUseProgram, glBindVertexArray, glBindBuffer, ...
+directly, otherwise the cache would no longer know what is actually bound.
+
+Deleting an object that might be bound has to go through the delete* functions here as well, because
+OpenGL reuses names: a new buffer can get the id of a deleted one and must not be treated as already bound.
+*/
+class GLStateCache
+{
+public:
+    GLStateCache() { invalidate(); }
+
+    // Forgets everything, the next call of each kind always reaches the driver.
+    void invalidate();
+    // Starts counting a new frame. The counts of the frame that just ended are kept in lastFrame().
+    void beginFrame();
+    const GLStateStats& lastFrame() const { return previous; }
+    const GLStateStats& thisFrame() const { return current; }
+
+    void useProgram(unsigned int program);
+    // Draws with the stages of a program pipeline object (separate shader objects). A program set with
+    // useProgram() would take precedence over it, so that is set to 0.
+    void bindProgramPipeline(unsigned int pipeline);
+    void bindVertexArray(unsigned int vao);
+    // GL_ELEMENT_ARRAY_BUFFER belongs to the bound VAO, so it is forgotten whenever the VAO changes.
+    // Targets other than array, element and uniform buffers are passed straight through.
+    void bindBuffer(GLenum target, unsigned int buffer);
+    void bindBufferBase(GLenum target, unsigned int index, unsigned int buffer);
+    // Binds part of a buffer, e.g. one slice of the uniformRing. offset has to be a multiple of
+    // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT for uniform buffers.
+    void bindBufferRange(GLenum target, unsigned int index, unsigned int buffer, size_t offset, size_t size);
+    void bindTexture(unsigned int unit, unsigned int texture);
+    // Binds to GL_FRAMEBUFFER, which sets both the read and the draw framebuffer.
+    void bindFramebuffer(unsigned int framebuffer);
+    void bindReadFramebuffer(unsigned int framebuffer);
+    void bindDrawFramebuffer(unsigned int framebuffer);
+    void setBlend(bool enabled);
+    void blendFunc(GLenum source, GLenum destination);
+    void setScissorTest(bool enabled);
+    void scissor(int x, int y, int width, int height);
+    void viewport(int x, int y, int width, int height);
+    void clearColor(float r, float g, float b, float a);
+
+    // What is currently set, for code that has to put the state back after changing it.
+    unsigned int boundDrawFramebuffer() const { return drawFramebuffer; }
+    // ~0u if unknown, e.g. right after invalidate().
+    unsigned int boundVertexArray() const { return vertexArray; }
+    unsigned int boundArrayBuffer() const { return arrayBuffer; }
+    bool scissorTestEnabled() const { return scissorTest == 1; }
+    // Returns false if the viewport was never set through the cache.
+    bool getViewport(int out[4]) const;
+
+    void deleteProgram(unsigned int program);
+    void deleteProgramPipeline(unsigned int pipeline);
+    void deleteVertexArray(unsigned int vao);
+    void deleteBuffer(unsigned int buffer);
+    void deleteTexture(unsigned int texture);
+    void deleteFramebuffer(unsigned int framebuffer);
+
+private:
+    bool changed(unsigned int& cached, unsigned int value);
+
+    unsigned int program = ~0u;
+    unsigned int programPipeline = ~0u;
+    unsigned int vertexArray = ~0u;
+    unsigned int arrayBuffer = ~0u;
+    unsigned int elementBuffer = ~0u;
+    unsigned int uniformBuffer = ~0u;
+    unsigned int uniformBindings[MAX_UNIFORM_BINDINGS];
+    // the range bound to each uniform binding, size 0 for the whole buffer
+    size_t uniformOffsets[MAX_UNIFORM_BINDINGS];
+    size_t uniformSizes[MAX_UNIFORM_BINDINGS];
+    unsigned int activeTexture = ~0u;
+    unsigned int textures[MAX_TEXTURE_UNITS];
+    unsigned int readFramebuffer = ~0u;
+    unsigned int drawFramebuffer = ~0u;
+    unsigned int blend = ~0u;
+    unsigned int blendSource = ~0u, blendDestination = ~0u;
+    unsigned int scissorTest = ~0u;
+    int scissorBox[4] = { -1, -1, -1, -1 };
+    int viewportBox[4] = { -1, -1, -1, -1 };
+    float clear[4] = { -1.0f, -1.0f, -1.0f, -1.0f };
+
+    GLStateStats current = { 0, 0 };
+    GLStateStats previous = { 0, 0 };
+};
+
+// The state of the one OpenGL context the game renders with.
+extern GLStateCache glState;
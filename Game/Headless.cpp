@@ -0,0 +1,221 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "GLState.h"
+#include "Headless.h"
+
+#ifdef __linux__
+static bool hasExtension(const char* extensions, const char* name)
+{
+    if (!extensions)
+        return false;
+    size_t length = strlen(name);
+    for (const char* found = strstr(extensions, name); found; found = strstr(found + length, name))
+        if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0'))
+            return true;
+    return false;
+}
+
+bool HeadlessContext::create()
+{
+    // Prefer Mesa's surfaceless platform, it needs neither a display server nor a GPU.
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay && hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (eglDisplay == EGL_NO_DISPLAY)
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor))
+    {
+        std::cout << "ERROR::HEADLESS::EGL_INITIALIZE_FAILED" << std::endl;
+        return false;
+    }
+    eglBindAPI(EGL_OPENGL_API);
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount) || configCount == 0)
+    {
+        std::cout << "ERROR::HEADLESS::NO_EGL_CONFIG" << std::endl;
+        eglTerminate(eglDisplay);
+        return false;
+    }
+
+    // Same context the window gets: OpenGL 3.3 core profile.
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+    if (eglContext == EGL_NO_CONTEXT)
+    {
+        std::cout << "ERROR::HEADLESS::EGL_CONTEXT_CREATION_FAILED" << std::endl;
+        eglTerminate(eglDisplay);
+        return false;
+    }
+
+    EGLSurface eglSurface = EGL_NO_SURFACE;
+    if (!hasExtension(eglQueryString(eglDisplay, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context"))
+    {
+        const EGLint pbufferAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        eglSurface = eglCreatePbufferSurface(eglDisplay, config, pbufferAttributes);
+    }
+    if (!eglMakeCurrent(eglDisplay, eglSurface, eglSurface, eglContext))
+    {
+        std::cout << "ERROR::HEADLESS::EGL_MAKE_CURRENT_FAILED" << std::endl;
+        eglDestroyContext(eglDisplay, eglContext);
+        eglTerminate(eglDisplay);
+        return false;
+    }
+
+    display = eglDisplay;
+    context = eglContext;
+    surface = eglSurface;
+    return true;
+}
+
+void HeadlessContext::destroy()
+{
+    if (!display)
+        return;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface)
+        eglDestroySurface(display, surface);
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+    display = context = surface = nullptr;
+}
+
+GLADloadproc HeadlessContext::loader() const
+{
+    return (GLADloadproc)eglGetProcAddress;
+}
+#else
+bool HeadlessContext::create()
+{
+    if (!glfwInit())
+        return false;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    hiddenWindow = glfwCreateWindow(1, 1, "headless", NULL, NULL);
+    if (!hiddenWindow)
+    {
+        glfwTerminate();
+        return false;
+    }
+    glfwMakeContextCurrent(hiddenWindow);
+    return true;
+}
+
+void HeadlessContext::destroy()
+{
+    if (!hiddenWindow)
+        return;
+    glfwDestroyWindow(hiddenWindow);
+    glfwTerminate();
+    hiddenWindow = nullptr;
+}
+
+GLADloadproc HeadlessContext::loader() const
+{
+    return (GLADloadproc)glfwGetProcAddress;
+}
+#endif
+
+bool OffscreenTarget::create(int newWidth, int newHeight)
+{
+    width = newWidth;
+    height = newHeight;
+    glGenFramebuffers(1, &FBO);
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glState.bindFramebuffer(FBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::HEADLESS::FRAMEBUFFER_NOT_COMPLETE" << std::endl;
+        destroy();
+        return false;
+    }
+    return true;
+}
+
+void OffscreenTarget::destroy()
+{
+    if (FBO)
+        glState.deleteFramebuffer(FBO);
+    if (colorBuffer)
+        glDeleteRenderbuffers(1, &colorBuffer);
+    FBO = colorBuffer = 0;
+}
+
+void OffscreenTarget::bind() const
+{
+    glState.bindFramebuffer(FBO);
+}
+
+void OffscreenTarget::readPixels(std::vector<unsigned char>& rgba) const
+{
+    rgba.resize((size_t)width * height * 4);
+    glState.bindReadFramebuffer(FBO);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+
+    // OpenGL returns the bottom row first, images are stored top row first
+    std::vector<unsigned char> row((size_t)width * 4);
+    for (int y = 0; y < height / 2; y++)
+    {
+        unsigned char* top = &rgba[(size_t)y * width * 4];
+        unsigned char* bottom = &rgba[(size_t)(height - 1 - y) * width * 4];
+        memcpy(row.data(), top, row.size());
+        memcpy(top, bottom, row.size());
+        memcpy(bottom, row.data(), row.size());
+    }
+}
+
+bool OffscreenTarget::writePPM(const char* path) const
+{
+    std::vector<unsigned char> rgba;
+    readPixels(rgba);
+    return ::writePPM(path, rgba, width, height);
+}
+
+bool writePPM(const char* path, const std::vector<unsigned char>& rgba, int width, int height)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        std::cout << "ERROR::HEADLESS::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    for (size_t i = 0; i < (size_t)width * height * 4; i += 4)
+        fwrite(&rgba[i], 1, 3, file);
+    fclose(file);
+    return true;
+}
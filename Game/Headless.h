@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+
+struct GLFWwindow;
+
+/*
+An OpenGL 3.3 core context without a visible window, for build agents without a display server.
+On Linux it is an EGL context, surfaceless where Mesa supports it (llvmpipe runs fine without a GPU),
+otherwise with a 1x1 pbuffer. Everywhere else it falls back to a hidden GLFW window.
+There is no usable default framebuffer either way, so everything is drawn into an OffscreenTarget.
+*/
+class HeadlessContext
+{
+public:
+    bool create();
+    void destroy();
+    // The function glad should load the OpenGL entry points with.
+    GLADloadproc loader() const;
+
+private:
+#ifdef __linux__
+    void* display = nullptr;
+    void* context = nullptr;
+    void* surface = nullptr;
+#endif
+    GLFWwindow* hiddenWindow = nullptr;
+};
+
+// Writes tightly packed RGBA rows, top row first, as a binary PPM. The alpha channel is dropped.
+bool writePPM(const char* path, const std::vector<unsigned char>& rgba, int width, int height);
+
+// A framebuffer object with a color renderbuffer that takes the place of the window's framebuffer.
+class OffscreenTarget
+{
+public:
+    bool create(int width, int height);
+    void destroy();
+    void bind() const;
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // Reads the picture back as tightly packed RGBA rows, top row first.
+    void readPixels(std::vector<unsigned char>& rgba) const;
+    // Writes the picture as a binary PPM, e.g. for golden image tests.
+    bool writePPM(const char* path) const;
+
+private:
+    unsigned int FBO = 0, colorBuffer = 0;
+    int width = 0, height = 0;
+};
@@ -0,0 +1,316 @@
+#include "IndexedMesh.h"
+#include "GLState.h"
+#include "Profiler.h"
+#include "RenderDevice.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+// Tuning values from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+const int FORSYTH_CACHE_SIZE = 32;
+const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+const float FORSYTH_LAST_TRI_SCORE = 0.75f;
+const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+size_t MeshBuilder::VertexHash::operator()(const MeshVertex& v) const
+{
+    // FNV-1a over the raw bytes
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&v);
+    size_t hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(MeshVertex); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool MeshBuilder::VertexEqual::operator()(const MeshVertex& a, const MeshVertex& b) const
+{
+    return memcmp(&a, &b, sizeof(MeshVertex)) == 0;
+}
+
+void MeshBuilder::clear()
+{
+    vertices.clear();
+    indices.clear();
+    lookup.clear();
+}
+
+unsigned int MeshBuilder::addVertex(const MeshVertex& v)
+{
+    auto found = lookup.find(v);
+    if (found != lookup.end())
+        return found->second;
+    unsigned int index = (unsigned int)vertices.size();
+    vertices.push_back(v);
+    lookup.emplace(v, index);
+    return index;
+}
+
+void MeshBuilder::addTriangle(const MeshVertex& a, const MeshVertex& b, const MeshVertex& c)
+{
+    indices.push_back(addVertex(a));
+    indices.push_back(addVertex(b));
+    indices.push_back(addVertex(c));
+}
+
+void MeshBuilder::addQuad(const Panel& p)
+{
+    MeshVertex bottomLeft = { p.x,       p.y,       p.r, p.g, p.b, p.a };
+    MeshVertex topLeft = { p.x,       p.y + p.h, p.r, p.g, p.b, p.a };
+    MeshVertex topRight = { p.x + p.w, p.y + p.h, p.r, p.g, p.b, p.a };
+    MeshVertex bottomRight = { p.x + p.w, p.y,       p.r, p.g, p.b, p.a };
+    addTriangle(bottomLeft, topLeft, topRight);
+    addTriangle(topRight, bottomRight, bottomLeft);
+}
+
+static float forsythVertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+    // no triangles left to draw, the vertex is no use anymore
+    if (remainingTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // The vertices of the last triangle get a fixed score so the next triangle
+        // doesn't just pick the same ones and produce a long thin strip.
+        if (cachePosition < 3)
+            score = FORSYTH_LAST_TRI_SCORE;
+        else
+        {
+            float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = powf(1.0f - (cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+        }
+    }
+    // Boost vertices with few triangles left so lone vertices get finished off.
+    score += FORSYTH_VALENCE_BOOST_SCALE * powf((float)remainingTriangles, -FORSYTH_VALENCE_BOOST_POWER);
+    return score;
+}
+
+void MeshBuilder::optimize()
+{
+    const unsigned int vertexCount = (unsigned int)vertices.size();
+    const unsigned int triangleCount = (unsigned int)indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Per vertex list of the triangles using it, stored back to back.
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (unsigned int index : indices)
+        remaining[index]++;
+    std::vector<unsigned int> firstTriangle(vertexCount + 1, 0);
+    for (unsigned int v = 0; v < vertexCount; v++)
+        firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+    std::vector<unsigned int> triangleList(indices.size());
+    std::vector<unsigned int> filled(vertexCount, 0);
+    for (unsigned int t = 0; t < triangleCount; t++)
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = indices[t * 3 + k];
+            triangleList[firstTriangle[v] + filled[v]++] = t;
+        }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (unsigned int v = 0; v < vertexCount; v++)
+        vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+
+    // Start with the highest scoring triangle, after that only triangles around the cache are looked at.
+    std::vector<bool> triangleAdded(triangleCount, false);
+    int bestTriangle = -1;
+    float bestScore = -1.0f;
+    for (unsigned int t = 0; t < triangleCount; t++)
+    {
+        float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestTriangle = (int)t;
+        }
+    }
+
+    std::vector<unsigned int> cache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    std::vector<unsigned int> newCache;
+    newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+    std::vector<unsigned int> optimized;
+    optimized.reserve(indices.size());
+
+    unsigned int scanCursor = 0;
+    for (unsigned int drawn = 0; drawn < triangleCount; drawn++)
+    {
+        // Nothing useful in the cache (e.g. a new disconnected piece): take the next unused triangle.
+        if (bestTriangle < 0)
+        {
+            while (triangleAdded[scanCursor])
+                scanCursor++;
+            bestTriangle = (int)scanCursor;
+        }
+
+        triangleAdded[bestTriangle] = true;
+        const unsigned int* corners = &indices[bestTriangle * 3];
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = corners[k];
+            optimized.push_back(v);
+
+            // remove the triangle from the vertex's list of remaining triangles
+            unsigned int* list = &triangleList[firstTriangle[v]];
+            for (unsigned int i = 0; i < remaining[v]; i++)
+                if (list[i] == (unsigned int)bestTriangle)
+                {
+                    list[i] = list[remaining[v] - 1];
+                    break;
+                }
+            remaining[v]--;
+        }
+
+        // Move the triangle's vertices to the front of the LRU cache.
+        newCache.assign(corners, corners + 3);
+        for (unsigned int v : cache)
+            if (v != corners[0] && v != corners[1] && v != corners[2])
+                newCache.push_back(v);
+        cache.swap(newCache);
+
+        for (unsigned int i = 0; i < cache.size(); i++)
+        {
+            unsigned int v = cache[i];
+            cachePosition[v] = i < (unsigned int)FORSYTH_CACHE_SIZE ? (int)i : -1;
+            vertexScore[v] = forsythVertexScore(cachePosition[v], remaining[v]);
+        }
+        // Rescore the triangles touching anything in the cache and pick the best one.
+        bestScore = -1.0f;
+        bestTriangle = -1;
+        for (unsigned int v : cache)
+        {
+            const unsigned int* list = &triangleList[firstTriangle[v]];
+            for (unsigned int i = 0; i < remaining[v]; i++)
+            {
+                unsigned int t = list[i];
+                float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = (int)t;
+                }
+            }
+        }
+        // Vertices that fell off the end of the cache are forgotten.
+        if (cache.size() > (size_t)FORSYTH_CACHE_SIZE)
+            cache.resize(FORSYTH_CACHE_SIZE);
+    }
+
+    // Renumber the vertices in the order the new index list first touches them.
+    std::vector<unsigned int> remap(vertexCount, ~0u);
+    std::vector<MeshVertex> reordered;
+    reordered.reserve(vertexCount);
+    for (unsigned int& index : optimized)
+    {
+        if (remap[index] == ~0u)
+        {
+            remap[index] = (unsigned int)reordered.size();
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(reordered);
+    indices.swap(optimized);
+
+    lookup.clear();
+    for (unsigned int v = 0; v < (unsigned int)vertices.size(); v++)
+        lookup.emplace(vertices[v], v);
+}
+
+GLenum MeshBuilder::indexType() const
+{
+    return vertices.size() <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+void MeshBuilder::packIndices(std::vector<unsigned char>& out) const
+{
+    if (indexType() == GL_UNSIGNED_SHORT)
+    {
+        out.resize(indices.size() * sizeof(unsigned short));
+        unsigned short* shorts = reinterpret_cast<unsigned short*>(out.data());
+        for (size_t i = 0; i < indices.size(); i++)
+            shorts[i] = (unsigned short)indices[i];
+    }
+    else
+    {
+        out.resize(indices.size() * sizeof(unsigned int));
+        memcpy(out.data(), indices.data(), out.size());
+    }
+}
+
+float MeshBuilder::averageCacheMissRatio(unsigned int cacheSize) const
+{
+    if (indices.empty())
+        return 0.0f;
+    std::vector<unsigned int> fifo;
+    unsigned int misses = 0;
+    for (unsigned int index : indices)
+    {
+        if (std::find(fifo.begin(), fifo.end(), index) != fifo.end())
+            continue;
+        misses++;
+        fifo.push_back(index);
+        if (fifo.size() > cacheSize)
+            fifo.erase(fifo.begin());
+    }
+    return (float)misses / (indices.size() / 3);
+}
+
+static const VertexAttribute meshAttributes[] = {
+    { 0, 2, GL_FLOAT, false, false, offsetof(MeshVertex, x), "aPos" },
+    { 1, 4, GL_FLOAT, false, false, offsetof(MeshVertex, r), "aColor" }
+};
+static const VertexLayout meshLayout = { meshAttributes, 2, sizeof(MeshVertex), 0 };
+
+void IndexedMesh::upload(const MeshBuilder& builder)
+{
+    PROFILE_ZONE("IndexedMesh::upload");
+    if (!VAO)
+    {
+        VAO = renderDevice.createVertexArray();
+        renderDevice.setVertexFormat(VAO, 0, meshLayout);
+    }
+
+    const std::vector<MeshVertex>& vertices = builder.getVertices();
+    std::vector<unsigned char> indexData;
+    builder.packIndices(indexData);
+
+    // static buffers, a new mesh gets new ones
+    if (VBO)
+    {
+        glState.deleteBuffer(VBO);
+        glState.deleteBuffer(EBO);
+    }
+    VBO = renderDevice.createBuffer(vertices.size() * sizeof(MeshVertex), vertices.data(), BUFFER_STATIC);
+    EBO = renderDevice.createBuffer(indexData.size(), indexData.data(), BUFFER_STATIC);
+    renderDevice.setVertexBuffer(VAO, 0, VBO, 0, meshLayout);
+    renderDevice.setElementBuffer(VAO, EBO);
+
+    indexCount = builder.indexCount();
+    indexType = builder.indexType();
+}
+
+void IndexedMesh::destroy()
+{
+    glState.deleteVertexArray(VAO);
+    glState.deleteBuffer(VBO);
+    glState.deleteBuffer(EBO);
+    VAO = VBO = EBO = 0;
+    indexCount = 0;
+}
+
+void IndexedMesh::draw() const
+{
+    if (indexCount == 0)
+        return;
+    glState.bindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
+}
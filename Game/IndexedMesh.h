@@ -0,0 +1,80 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include "QuadBatch.h"
+
+// Same layout as the quad batch vertices, so meshes are drawn with the quad batch program.
+struct MeshVertex
+{
+    float x, y;
+    float r, g, b, a;
+};
+
+/*
+Builds indexed triangle meshes out of arbitrary triangles.
+Identical vertices are only stored once and referenced through the index list, so two triangles sharing
+an edge cost 4 vertices instead of 6. When a mesh has at most 65536 unique vertices the indices are
+emitted as 16-bit values, halving the size of the index buffer.
+*/
+class MeshBuilder
+{
+public:
+    void clear();
+
+    // Returns the index of v, adding it if no identical vertex exists yet.
+    unsigned int addVertex(const MeshVertex& v);
+    void addTriangle(const MeshVertex& a, const MeshVertex& b, const MeshVertex& c);
+    // Adds a panel as two triangles sharing their diagonal.
+    void addQuad(const Panel& panel);
+
+    /*
+    Reorders the triangles so vertices that were just transformed are reused while they are still in the
+    GPU's post-transform cache (Tom Forsyth's linear-speed vertex cache optimisation), then reorders the
+    vertices in the order they are first used so vertex fetches walk through memory linearly.
+    */
+    void optimize();
+
+    const std::vector<MeshVertex>& getVertices() const { return vertices; }
+    unsigned int indexCount() const { return (unsigned int)indices.size(); }
+    // GL_UNSIGNED_SHORT when every index fits in 16 bits, GL_UNSIGNED_INT otherwise.
+    GLenum indexType() const;
+    // Fills out with the indices in indexType() format.
+    void packIndices(std::vector<unsigned char>& out) const;
+
+    // Average number of vertex shader runs per triangle with a FIFO cache of cacheSize entries.
+    // 3.0 means nothing is reused, 0.5 is the best a regular grid can do.
+    float averageCacheMissRatio(unsigned int cacheSize) const;
+
+private:
+    struct VertexHash
+    {
+        size_t operator()(const MeshVertex& v) const;
+    };
+    struct VertexEqual
+    {
+        bool operator()(const MeshVertex& a, const MeshVertex& b) const;
+    };
+
+    std::vector<MeshVertex> vertices;
+    std::vector<unsigned int> indices;
+    std::unordered_map<MeshVertex, unsigned int, VertexHash, VertexEqual> lookup;
+};
+
+// The GPU side of a mesh: one VAO, VBO and EBO drawn with a single glDrawElements.
+class IndexedMesh
+{
+public:
+    void upload(const MeshBuilder& builder);
+    void destroy();
+    // Draws the mesh with the currently bound program.
+    void draw() const;
+
+private:
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    unsigned int indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+};
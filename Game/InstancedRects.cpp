@@ -0,0 +1,224 @@
+#include "InstancedRects.h"
+#include "GLState.h"
+#include "MaterialTable.h"
+#include "Profiler.h"
+#include "RenderDevice.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+// Vertex buffer bindings of the VAO: the unit quad per vertex, the RectInstances per instance.
+const unsigned int QUAD_BINDING = 0;
+const unsigned int INSTANCE_BINDING = 1;
+
+static const VertexAttribute quadAttributes[] = {
+    { 0, 2, GL_FLOAT, false, false, 0, "aCorner" }
+};
+static const VertexLayout quadLayout = { quadAttributes, 1, 2 * sizeof(float), 0 };
+
+static const VertexAttribute instanceAttributes[] = {
+    { 1, 4, GL_FLOAT, false, false, offsetof(RectInstance, x), "aRect" },
+    // the 4 color bytes are normalized from 0..255 to 0.0..1.0
+    { 2, 4, GL_UNSIGNED_BYTE, true, false, offsetof(RectInstance, color), "aColor" },
+    { 3, 1, GL_FLOAT, false, false, offsetof(RectInstance, depth), "aDepth" },
+    // integer attribute, to keep it from being converted to float
+    { 4, 1, GL_UNSIGNED_INT, false, true, offsetof(RectInstance, material), "aMaterial" },
+    { 5, 1, GL_FLOAT, false, false, offsetof(RectInstance, radius), "aRadius" }
+};
+static const VertexLayout instanceLayout = { instanceAttributes, 5, sizeof(RectInstance), 1 };
+
+// The vertex shader without its inputs, which come from quadLayout and instanceLayout.
+static const char* instancedVertexShaderBody =
+MATERIAL_BLOCK_GLSL
+"out vec4 vColor;\n"
+"out vec2 vCorner;\n"
+"flat out float vRadius;\n"
+"void main()\n"
+"{\n"
+"   gl_Position = vec4(aRect.xy + aCorner * aRect.zw, aDepth, 1.0);\n"
+"#ifdef FEATURE_GRADIENT\n"
+"   // the instance color at the bottom, fading to the plain material color at the top\n"
+"   vColor = mix(aColor, vec4(1.0), aCorner.y) * materialColors[aMaterial];\n"
+"#else\n"
+"   vColor = aColor * materialColors[aMaterial];\n"
+"#endif\n"
+"   vCorner = aCorner;\n"
+"   vRadius = aRadius;\n"
+"}\n";
+
+static const std::string instancedVertexShader = std::string("#version 330 core\n")
+    + vertexInputsGLSL(quadLayout) + vertexInputsGLSL(instanceLayout) + instancedVertexShaderBody;
+const char* instancedVertexShaderSource = instancedVertexShader.c_str();
+
+const char* instancedFragmentShaderSource = "#version 330 core\n"
+"in vec4 vColor;\n"
+"in vec2 vCorner;\n"
+"flat in float vRadius;\n"
+"#ifdef FEATURE_TEXTURE\n"
+"uniform sampler2D uTexture;\n"
+"#endif\n"
+"out vec4 FragColor;\n"
+"void main()\n"
+"{\n"
+"   vec4 color = vColor;\n"
+"#ifdef FEATURE_ROUNDED\n"
+"   // the size in pixels follows from how much the corner coordinates change from one pixel to the next\n"
+"   vec2 size = 1.0 / abs(vec2(dFdx(vCorner.x), dFdy(vCorner.y)));\n"
+"   float radius = min(vRadius, 0.5 * min(size.x, size.y));\n"
+"   vec2 outside = abs(vCorner - 0.5) * size - (0.5 * size - radius);\n"
+"   if (length(max(outside, 0.0)) > radius)\n"
+"       discard;\n"
+"#endif\n"
+"#ifdef FEATURE_TEXTURE\n"
+"   color *= texture(uTexture, vCorner);\n"
+"#endif\n"
+"   FragColor = color;\n"
+"}\n\0";
+
+// Every variant reads its colors from the material table. Only the gradient changes the vertex shader.
+const ShaderTemplate rectShaderTemplate = {
+    "instanced rects", "instanced_rects", instancedVertexShaderSource, instancedFragmentShaderSource,
+    RECT_SHADER_FEATURES, SHADER_GRADIENT, true, MaterialTable::attachToProgram
+};
+
+bool InstancedRects::init(unsigned int initialInstances, InstanceUpload instanceUpload)
+{
+    shaders.reset();
+    setFeatures(0);
+    upload = instanceUpload;
+
+    // drawn as a triangle strip: bottom left, top left, bottom right, top right
+    float unitQuad[] = {
+        0.0f, 0.0f,
+        0.0f, 1.0f,
+        1.0f, 0.0f,
+        1.0f, 1.0f
+    };
+
+    VAO = renderDevice.createVertexArray();
+    quadVBO = renderDevice.createBuffer(sizeof(unitQuad), unitQuad, BUFFER_STATIC);
+    renderDevice.setVertexFormat(VAO, QUAD_BINDING, quadLayout);
+    renderDevice.setVertexBuffer(VAO, QUAD_BINDING, quadVBO, 0, quadLayout);
+    renderDevice.setVertexFormat(VAO, INSTANCE_BINDING, instanceLayout);
+
+    capacity = initialInstances > 0 ? initialInstances : 1;
+    if (upload == INSTANCES_STREAMED)
+    {
+        stream.init(capacity * sizeof(RectInstance));
+        return true;
+    }
+    instanceVBO = renderDevice.createBuffer(capacity * sizeof(RectInstance), NULL, BUFFER_DYNAMIC);
+    renderDevice.setVertexBuffer(VAO, INSTANCE_BINDING, instanceVBO, 0, instanceLayout);
+    return true;
+}
+
+void InstancedRects::destroy()
+{
+    glState.deleteVertexArray(VAO);
+    glState.deleteBuffer(quadVBO);
+    glState.deleteBuffer(instanceVBO);
+    VAO = quadVBO = instanceVBO = 0;
+    stream.destroy();
+    shaders.reset();
+    capacity = 0;
+    uploadedInstances = 0;
+}
+
+void InstancedRects::setFeatures(unsigned int features)
+{
+    variant = rectShaderVariant(features);
+    shaders.request(variant);
+}
+
+void InstancedRects::begin()
+{
+    instances.clear();
+}
+
+void InstancedRects::submit(const RectInstance& rect)
+{
+    instances.push_back(rect);
+}
+
+void InstancedRects::end()
+{
+    PROFILE_ZONE("InstancedRects::end");
+    if (upload == INSTANCES_STREAMED)
+    {
+        // lands in the segment of frameSync's current frame
+        uploadedInstances = 0;
+        if (!instances.empty())
+        {
+            StreamAllocation allocation = stream.map(instances.size() * sizeof(RectInstance));
+            if (allocation.data)
+            {
+                memcpy(allocation.data, instances.data(), instances.size() * sizeof(RectInstance));
+                stream.unmap();
+                renderDevice.setVertexBuffer(VAO, INSTANCE_BINDING, allocation.buffer, allocation.offset, instanceLayout);
+                uploadedInstances = (unsigned int)instances.size();
+            }
+        }
+    }
+    else
+    {
+        if (instances.size() > capacity)
+        {
+            // buffers can't grow, a bigger one takes the place of the old one
+            capacity = (unsigned int)instances.size() * 2;
+            glState.deleteBuffer(instanceVBO);
+            instanceVBO = renderDevice.createBuffer(capacity * sizeof(RectInstance), NULL, BUFFER_DYNAMIC);
+            renderDevice.setVertexBuffer(VAO, INSTANCE_BINDING, instanceVBO, 0, instanceLayout);
+        }
+        renderDevice.updateBuffer(instanceVBO, 0, instances.size() * sizeof(RectInstance), instances.data());
+        uploadedInstances = (unsigned int)instances.size();
+    }
+
+    // nothing uploaded covers nothing, not whatever the last frame drew
+    if (uploadedInstances == 0)
+    {
+        std::fill(bounds, bounds + 4, 0.0f);
+        return;
+    }
+    float minX = instances[0].x, minY = instances[0].y;
+    float maxX = minX + instances[0].w, maxY = minY + instances[0].h;
+    for (const RectInstance& rect : instances)
+    {
+        minX = std::min(minX, rect.x);
+        minY = std::min(minY, rect.y);
+        maxX = std::max(maxX, rect.x + rect.w);
+        maxY = std::max(maxY, rect.y + rect.h);
+    }
+    bounds[0] = minX;
+    bounds[1] = minY;
+    bounds[2] = maxX - minX;
+    bounds[3] = maxY - minY;
+}
+
+void InstancedRects::draw() const
+{
+    if (uploadedInstances == 0 || !shaders.bind(variant))
+        return;
+    if (texture)
+        glState.bindTexture(0, texture);
+    glState.bindVertexArray(VAO);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, uploadedInstances);
+}
+
+DrawCommand InstancedRects::drawCommand() const
+{
+    DrawCommand command;
+    command.program = shaders.program(variant);
+    command.pipeline = shaders.pipeline(variant);
+    command.texture = texture;
+    command.vertexArray = VAO;
+    command.kind = DRAW_ARRAYS_INSTANCED;
+    command.mode = GL_TRIANGLE_STRIP;
+    command.count = 4;
+    command.instanceCount = uploadedInstances;
+    command.x = bounds[0];
+    command.y = bounds[1];
+    command.w = bounds[2];
+    command.h = bounds[3];
+    return command;
+}
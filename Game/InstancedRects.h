@@ -0,0 +1,91 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+
+#include "RenderQueue.h"
+#include "ShaderVariants.h"
+#include "StreamBuffer.h"
+#include "VertexFormat.h"
+
+const unsigned int COLOR_WHITE = 0xFFFFFFFFu;
+
+// One rectangle as seen by the GPU: 32 bytes instead of six vec3 vertices (72 bytes).
+struct RectInstance
+{
+    float x, y, w, h;   // bottom left corner and size in normalized device coordinates
+    unsigned int color; // packColor(), multiplied with the material color
+    float depth;
+    unsigned int material; // index into the MaterialTable, 0 is white
+    float radius;          // corner radius in pixels, only used by SHADER_ROUNDED
+};
+static_assert(sizeof(RectInstance) == 32, "RectInstance must stay 32 bytes");
+
+// The instancing program, the vertex shader includes the material block.
+// These are the sources of rectShaderTemplate, compiled as they are they give the variant without features.
+extern const char* instancedVertexShaderSource;
+extern const char* instancedFragmentShaderSource;
+
+// The features the rectangle shaders support and the variant id of a feature set.
+const unsigned int RECT_SHADER_FEATURES = SHADER_TEXTURE | SHADER_ROUNDED | SHADER_GRADIENT;
+constexpr unsigned int rectShaderVariant(unsigned int features)
+{
+    return shaderVariantId(RECT_SHADER_FEATURES, features);
+}
+extern const ShaderTemplate rectShaderTemplate;
+
+// How end() gets the instances to the GPU.
+enum InstanceUpload
+{
+    INSTANCES_STATIC,  // glBufferSubData into the instance buffer, for rectangles that rarely change
+    INSTANCES_STREAMED // copied into a persistently mapped StreamBuffer, for rectangles that change every frame
+};
+
+/*
+Draws rectangles with instancing. A single unit quad (0,0)-(1,1) lives in its own VBO and
+glDrawArraysInstanced draws it once per RectInstance. The RectInstance attributes come from a second vertex
+buffer binding with a divisor of 1, which tells OpenGL to advance them once per instance instead of once per
+vertex, so the vertex shader scales and moves the unit quad into place for each rectangle.
+The final color is the instance color times its material from the MaterialTable bound at MATERIAL_BINDING.
+setFeatures() switches every rectangle to a variant of the program, e.g. with rounded corners.
+Streamed instances go into the current frame's segment of a StreamBuffer and the instance attributes are
+pointed at wherever they landed, so rewriting them every frame never waits for the GPU to finish the last one.
+With direct state access, pointing them somewhere else is a single glVertexArrayVertexBuffer.
+*/
+class InstancedRects
+{
+public:
+    // Creates the buffers and asks shaderPipeline for the instancing program. Draws are skipped until the
+    // program is ready, a program that fails to build is reported by the pipeline.
+    bool init(unsigned int initialInstances, InstanceUpload upload = INSTANCES_STATIC);
+    void destroy();
+
+    // ShaderFeatures to draw with, out of RECT_SHADER_FEATURES. A variant not used before is built first,
+    // nothing is drawn until it is ready.
+    void setFeatures(unsigned int features);
+    // The texture SHADER_TEXTURE multiplies with, drawn over the whole rectangle.
+    void setTexture(unsigned int texture) { this->texture = texture; }
+
+    void begin();
+    void submit(const RectInstance& rect);
+    void end();
+    // Binds its own program and draws every rectangle with one call.
+    void draw() const;
+    // The same draw as a command for a RenderQueue, with the bounds of all uploaded rectangles.
+    DrawCommand drawCommand() const;
+
+    unsigned int instanceCount() const { return (unsigned int)instances.size(); }
+    const StreamStats& streamStats() const { return stream.getStats(); }
+
+private:
+    std::vector<RectInstance> instances;
+    unsigned int capacity = 0;
+    unsigned int uploadedInstances = 0;
+    float bounds[4] = { 0.0f, 0.0f, 0.0f, 0.0f }; // x, y, w, h
+    ShaderVariants shaders{ rectShaderTemplate };
+    unsigned int variant = 0;
+    unsigned int texture = 0;
+    InstanceUpload upload = INSTANCES_STATIC;
+    StreamBuffer stream;
+    unsigned int VAO = 0, quadVBO = 0, instanceVBO = 0;
+};
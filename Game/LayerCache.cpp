@@ -0,0 +1,226 @@
+#include <glad/glad.h>
+#include <cmath>
+#include <iostream>
+
+#include "GLState.h"
+#include "LayerCache.h"
+#include "RenderDevice.h"
+#include "UniformRing.h"
+
+// Draws a texture over a rectangle. The corners come from gl_VertexID, so no vertex buffer is needed.
+static const char* compositeVertexShaderSource = "#version 330 core\n"
+"layout (std140) uniform DrawConstants\n"
+"{\n"
+"   vec4 uRect;\n"
+"};\n"
+"out vec2 vTexCoord;\n"
+"void main()\n"
+"{\n"
+"   vec2 corner = vec2(gl_VertexID >> 1, gl_VertexID & 1);\n"
+"   gl_Position = vec4(uRect.xy + corner * uRect.zw, 0.0, 1.0);\n"
+"   vTexCoord = corner;\n"
+"}\0";
+
+static const char* compositeFragmentShaderSource = "#version 330 core\n"
+"uniform sampler2D uLayer;\n"
+"in vec2 vTexCoord;\n"
+"out vec4 FragColor;\n"
+"void main()\n"
+"{\n"
+"   FragColor = texture(uLayer, vTexCoord);\n"
+"}\n\0";
+
+// uRect comes from a slice of the uniformRing, so nothing is set on the program and the stages can be separate.
+const ShaderTemplate compositeShaderTemplate = {
+    "layer composite", "layer_composite", compositeVertexShaderSource, compositeFragmentShaderSource, 0, 0, true,
+    UniformRing::attachToProgram
+};
+
+bool LayerCache::init(size_t budgetBytes)
+{
+    budget = budgetBytes;
+    compositeShaders.reset();
+    compositeShaders.request(0);
+    // the core profile doesn't draw without a VAO bound, even one without attributes
+    emptyVAO = renderDevice.createVertexArray();
+    return true;
+}
+
+void LayerCache::destroy()
+{
+    for (auto& entry : layers)
+        release(entry.second);
+    layers.clear();
+    glState.deleteVertexArray(emptyVAO);
+    emptyVAO = 0;
+    compositeShaders.reset();
+}
+
+void LayerCache::beginFrame(int width, int height)
+{
+    frame++;
+    if (width == screenWidth && height == screenHeight)
+        return;
+    screenWidth = width;
+    screenHeight = height;
+    // every layer would need a texture of a different size
+    for (auto& entry : layers)
+        release(entry.second);
+}
+
+void LayerCache::invalidate(unsigned int layer)
+{
+    auto found = layers.find(layer);
+    if (found != layers.end())
+        found->second.valid = false;
+}
+
+void LayerCache::invalidateAll()
+{
+    for (auto& entry : layers)
+        entry.second.valid = false;
+}
+
+void LayerCache::release(Layer& layer)
+{
+    if (layer.texture)
+    {
+        glState.deleteFramebuffer(layer.FBO);
+        glState.deleteTexture(layer.texture);
+        stats.bytesUsed -= layer.bytes;
+    }
+    layer.FBO = layer.texture = 0;
+    layer.bytes = 0;
+    layer.valid = false;
+}
+
+bool LayerCache::makeRoom(size_t bytes, unsigned int keep)
+{
+    while (stats.bytesUsed + bytes > budget)
+    {
+        // evict the least recently drawn layer that still has a texture
+        Layer* oldest = nullptr;
+        for (auto& entry : layers)
+            if (entry.first != keep && entry.second.texture && (!oldest || entry.second.lastUsed < oldest->lastUsed))
+                oldest = &entry.second;
+        if (!oldest)
+            return false;
+        release(*oldest);
+        stats.evictions++;
+    }
+    return true;
+}
+
+void LayerCache::draw(unsigned int id, float x, float y, float w, float h, const std::function<void()>& render)
+{
+    if ((!compositeShaders.program(0) && !compositeShaders.pipeline(0)) || !uniformRing.isReady())
+    {
+        render();
+        return;
+    }
+    // round outwards to whole pixels so the texture maps 1:1 onto the screen
+    int x0 = (int)floorf((x + 1.0f) * 0.5f * screenWidth);
+    int y0 = (int)floorf((y + 1.0f) * 0.5f * screenHeight);
+    int x1 = (int)ceilf((x + w + 1.0f) * 0.5f * screenWidth);
+    int y1 = (int)ceilf((y + h + 1.0f) * 0.5f * screenHeight);
+
+    Layer& layer = layers[id];
+    layer.lastUsed = frame;
+    if (layer.x != x0 || layer.y != y0 || layer.width != x1 - x0 || layer.height != y1 - y0)
+    {
+        release(layer);
+        layer.x = x0;
+        layer.y = y0;
+        layer.width = x1 - x0;
+        layer.height = y1 - y0;
+    }
+
+    if (layer.valid)
+    {
+        stats.hits++;
+        composite(layer);
+        return;
+    }
+    stats.misses++;
+
+    size_t bytes = (size_t)layer.width * layer.height * 4;
+    if (layer.width <= 0 || layer.height <= 0 || bytes > budget)
+    {
+        render();
+        return;
+    }
+    if (!layer.texture)
+    {
+        if (!makeRoom(bytes, id))
+        {
+            render();
+            return;
+        }
+        glGenTextures(1, &layer.texture);
+        glState.bindTexture(0, layer.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, layer.width, layer.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glGenFramebuffers(1, &layer.FBO);
+        unsigned int previousFramebuffer = glState.boundDrawFramebuffer();
+        glState.bindFramebuffer(layer.FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, layer.texture, 0);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glState.bindFramebuffer(previousFramebuffer == ~0u ? 0 : previousFramebuffer);
+
+        layer.bytes = bytes;
+        stats.bytesUsed += bytes;
+        if (!complete)
+        {
+            std::cout << "ERROR::LAYER_CACHE::FRAMEBUFFER_NOT_COMPLETE" << std::endl;
+            release(layer);
+            render();
+            return;
+        }
+    }
+
+    renderLayer(layer, render);
+    layer.valid = true;
+    composite(layer);
+}
+
+void LayerCache::renderLayer(Layer& layer, const std::function<void()>& render)
+{
+    unsigned int previousFramebuffer = glState.boundDrawFramebuffer();
+    int previousViewport[4] = { 0, 0, screenWidth, screenHeight };
+    glState.getViewport(previousViewport);
+    bool scissorWasEnabled = glState.scissorTestEnabled();
+
+    // Move the viewport so the layer's part of the screen lands on the texture.
+    glState.bindFramebuffer(layer.FBO);
+    glState.setScissorTest(false);
+    glState.viewport(-layer.x, -layer.y, screenWidth, screenHeight);
+    // glClearBuffer leaves the clear color of the main framebuffer alone
+    const float transparent[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    glClearBufferfv(GL_COLOR, 0, transparent);
+    render();
+
+    glState.bindFramebuffer(previousFramebuffer == ~0u ? 0 : previousFramebuffer);
+    glState.viewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    glState.setScissorTest(scissorWasEnabled);
+}
+
+void LayerCache::composite(const Layer& layer)
+{
+    const float rect[4] = {
+        layer.x * 2.0f / screenWidth - 1.0f, layer.y * 2.0f / screenHeight - 1.0f,
+        layer.width * 2.0f / screenWidth, layer.height * 2.0f / screenHeight
+    };
+    UniformRing::bind(DRAW_CONSTANTS_BINDING, uniformRing.upload(rect, sizeof(rect)));
+    compositeShaders.bind(0);
+    glState.bindTexture(0, layer.texture);
+    glState.bindVertexArray(emptyVAO);
+    // The layer was cleared to transparent, so its contents are premultiplied by alpha.
+    glState.setBlend(true);
+    glState.blendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glState.setBlend(false);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+
+#include "ShaderVariants.h"
+
+// The program that draws a layer's texture onto the screen.
+extern const ShaderTemplate compositeShaderTemplate;
+
+struct LayerCacheStats
+{
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int evictions;
+    size_t bytesUsed;
+};
+
+/*
+Keeps rarely changing groups of panels (e.g. the top bar) as textures.
+The first time a layer is drawn its contents are rendered into a texture through a framebuffer object;
+after that the whole group is a single textured quad until the layer is invalidated.
+
+Textures are kept within a memory budget. When a new layer doesn't fit, the least recently drawn layers
+are evicted first. A layer larger than the whole budget is simply drawn directly every time, and so is
+every layer while shaderPipeline is still building the composite program. The rectangle a composite draw
+covers comes from the uniformRing, without it layers are drawn directly as well.
+*/
+class LayerCache
+{
+public:
+    bool init(size_t budgetBytes);
+    void destroy();
+
+    // Call once per frame, before drawing layers. A different framebuffer size invalidates every layer.
+    void beginFrame(int screenWidth, int screenHeight);
+
+    /*
+    Draws the layer covering the given normalized device coordinate bounds.
+    render draws the layer's contents exactly as it would onto the screen; it is only called on a cache miss.
+    */
+    void draw(unsigned int layer, float x, float y, float w, float h, const std::function<void()>& render);
+
+    void invalidate(unsigned int layer);
+    void invalidateAll();
+
+    const LayerCacheStats& getStats() const { return stats; }
+
+private:
+    struct Layer
+    {
+        unsigned int FBO = 0, texture = 0;
+        int x = 0, y = 0, width = 0, height = 0; // in pixels
+        size_t bytes = 0;
+        unsigned long long lastUsed = 0;
+        bool valid = false;
+    };
+
+    bool makeRoom(size_t bytes, unsigned int keep);
+    void release(Layer& layer);
+    void renderLayer(Layer& layer, const std::function<void()>& render);
+    void composite(const Layer& layer);
+
+    std::unordered_map<unsigned int, Layer> layers;
+    size_t budget = 0;
+    int screenWidth = 0, screenHeight = 0;
+    unsigned long long frame = 0;
+    ShaderVariants compositeShaders{ compositeShaderTemplate };
+    unsigned int emptyVAO = 0;
+    LayerCacheStats stats = { 0, 0, 0, 0 };
+};
@@ -0,0 +1,67 @@
+#include "MaterialTable.h"
+#include "GLState.h"
+#include "Profiler.h"
+#include "RenderDevice.h"
+#include <iostream>
+#include <vector>
+
+void MaterialTable::init()
+{
+    // Always allocate the whole array the shader declares, filled with zeros so unused slots read as zero
+    // instead of undefined.
+    std::vector<MaterialData> zeros(MAX_MATERIALS, MaterialData{});
+    UBO = renderDevice.createBuffer(MAX_MATERIALS * sizeof(MaterialData), zeros.data(), BUFFER_DYNAMIC);
+
+    materials.clear();
+    materials.push_back({ { 1.0f, 1.0f, 1.0f, 1.0f } });
+    dirty = true;
+}
+
+void MaterialTable::destroy()
+{
+    glState.deleteBuffer(UBO);
+    UBO = 0;
+    materials.clear();
+}
+
+unsigned int MaterialTable::add(float r, float g, float b, float a)
+{
+    if (materials.size() >= MAX_MATERIALS)
+    {
+        std::cout << "ERROR::MATERIALS::TABLE_FULL" << std::endl;
+        return 0;
+    }
+    materials.push_back({ { r, g, b, a } });
+    dirty = true;
+    return (unsigned int)materials.size() - 1;
+}
+
+void MaterialTable::set(unsigned int material, float r, float g, float b, float a)
+{
+    if (material >= materials.size())
+        return;
+    materials[material] = { { r, g, b, a } };
+    dirty = true;
+}
+
+void MaterialTable::upload()
+{
+    if (!dirty)
+        return;
+    PROFILE_ZONE("MaterialTable::upload");
+    renderDevice.updateBuffer(UBO, 0, materials.size() * sizeof(MaterialData), materials.data());
+    dirty = false;
+}
+
+void MaterialTable::bind() const
+{
+    glState.bindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BINDING, UBO);
+}
+
+void MaterialTable::attachToProgram(unsigned int program)
+{
+    // GLSL 3.30 has no layout(binding = ...), so the block is connected to the binding point from here.
+    unsigned int blockIndex = glGetUniformBlockIndex(program, "Materials");
+    if (blockIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, blockIndex, MATERIAL_BINDING);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+
+const unsigned int MAX_MATERIALS = 256;
+// Uniform buffer binding point the material table is bound to.
+const unsigned int MATERIAL_BINDING = 0;
+
+// GLSL side of the table, the array size has to match MAX_MATERIALS.
+// std140 puts every vec4 array element 16 bytes apart, which matches MaterialData.
+#define MATERIAL_BLOCK_GLSL \
+"layout (std140) uniform Materials\n" \
+"{\n" \
+"   vec4 materialColors[256];\n" \
+"};\n"
+
+struct MaterialData
+{
+    float color[4];
+};
+static_assert(sizeof(MaterialData) == 16, "MaterialData must match the std140 layout");
+
+/*
+All material colors in one uniform buffer. Draws only carry a material index, so any number of colors
+share one program and switching colors never needs a glUseProgram or glUniform call.
+Material 0 is always white, which leaves an instance's own color untouched.
+*/
+class MaterialTable
+{
+public:
+    void init();
+    void destroy();
+
+    // Returns the id of the new material, or 0 when the table is full.
+    unsigned int add(float r, float g, float b, float a);
+    void set(unsigned int material, float r, float g, float b, float a);
+    // Copies the table to the GPU if anything changed since the last upload.
+    void upload();
+    // Binds the buffer to MATERIAL_BINDING.
+    void bind() const;
+
+    // Points a program's "Materials" block at MATERIAL_BINDING. Needs to happen once per program.
+    static void attachToProgram(unsigned int program);
+
+private:
+    std::vector<MaterialData> materials;
+    unsigned int UBO = 0;
+    bool dirty = false;
+};
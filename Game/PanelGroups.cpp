@@ -0,0 +1,194 @@
+#include "PanelGroups.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "Profiler.h"
+#include "RenderDevice.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+// The vertex shader without its inputs, which panelGroupsVertexShader() generates. aGroup is offset, opacity.
+static const char* panelGroupsVertexShaderBody =
+"out vec4 vColor;\n"
+"void main()\n"
+"{\n"
+"   gl_Position = vec4(aPos + aGroup.xy, 0.0, 1.0);\n"
+"   vColor = vec4(aColor.rgb, aColor.a * aGroup.z);\n"
+"}\n";
+
+// Vertex buffer bindings of the VAO.
+const unsigned int VERTEX_BINDING = 0;
+const unsigned int DRAW_DATA_BINDING = 1;
+
+const VertexLayout& PanelGroups::vertexLayout()
+{
+    static const VertexAttribute attributes[] = {
+        { 0, 2, GL_FLOAT, false, false, offsetof(Vertex, x), "aPos" },
+        { 1, 4, GL_FLOAT, false, false, offsetof(Vertex, r), "aColor" }
+    };
+    static const VertexLayout layout = { attributes, 2, sizeof(Vertex), 0 };
+    return layout;
+}
+
+const VertexLayout& PanelGroups::drawDataLayout()
+{
+    static const VertexAttribute attributes[] = {
+        { 2, 4, GL_FLOAT, false, false, 0, "aGroup" }
+    };
+    static const VertexLayout layout = { attributes, 1, sizeof(GroupDrawData), 1 };
+    return layout;
+}
+
+std::string panelGroupsVertexShader()
+{
+    return std::string("#version 330 core\n") + vertexInputsGLSL(PanelGroups::vertexLayout())
+        + vertexInputsGLSL(PanelGroups::drawDataLayout()) + panelGroupsVertexShaderBody;
+}
+
+void PanelGroups::init(bool indirectIfSupported)
+{
+    destroy();
+    indirect = indirectIfSupported && glExt.multiDrawIndirect;
+    VAO = renderDevice.createVertexArray();
+    renderDevice.setVertexFormat(VAO, VERTEX_BINDING, vertexLayout());
+    renderDevice.setVertexFormat(VAO, DRAW_DATA_BINDING, drawDataLayout());
+    // commands and draw data of a few dozen groups per frame, it grows if that isn't enough
+    stream.init(4096);
+}
+
+void PanelGroups::destroy()
+{
+    glState.deleteVertexArray(VAO);
+    glState.deleteBuffer(VBO);
+    glState.deleteBuffer(EBO);
+    VAO = VBO = EBO = 0;
+    stream.destroy();
+    clear();
+}
+
+void PanelGroups::clear()
+{
+    vertices.clear();
+    groups.clear();
+}
+
+unsigned int PanelGroups::beginGroup()
+{
+    Group group;
+    group.firstVertex = (unsigned int)vertices.size();
+    groups.push_back(group);
+    return (unsigned int)groups.size() - 1;
+}
+
+void PanelGroups::submit(const Panel& p)
+{
+    if (groups.empty())
+        beginGroup();
+    // the same corners as QuadBatch
+    vertices.push_back({ p.x,       p.y,       p.r, p.g, p.b, p.a });
+    vertices.push_back({ p.x,       p.y + p.h, p.r, p.g, p.b, p.a });
+    vertices.push_back({ p.x + p.w, p.y + p.h, p.r, p.g, p.b, p.a });
+    vertices.push_back({ p.x + p.w, p.y,       p.r, p.g, p.b, p.a });
+    groups.back().quads++;
+}
+
+void PanelGroups::end()
+{
+    PROFILE_ZONE("PanelGroups::end");
+    // static buffers, new panels get new ones
+    if (VBO)
+    {
+        glState.deleteBuffer(VBO);
+        glState.deleteBuffer(EBO);
+    }
+    VBO = renderDevice.createBuffer(vertices.size() * sizeof(Vertex), vertices.data(), BUFFER_STATIC);
+    renderDevice.setVertexBuffer(VAO, VERTEX_BINDING, VBO, 0, vertexLayout());
+
+    // Indices count from the group's base vertex, so the pattern of the biggest group serves every group.
+    unsigned int quads = 1;
+    for (const Group& group : groups)
+        quads = std::max(quads, group.quads);
+    std::vector<unsigned int> indices(quads * 6);
+    for (unsigned int i = 0; i < quads; i++)
+    {
+        unsigned int v = i * 4;
+        unsigned int quad[6] = { v + 0, v + 1, v + 2, v + 2, v + 3, v + 0 };
+        std::copy(quad, quad + 6, &indices[i * 6]);
+    }
+    indexType = quads * 4 <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    if (indexType == GL_UNSIGNED_SHORT)
+    {
+        std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+        EBO = renderDevice.createBuffer(shortIndices.size() * sizeof(unsigned short), shortIndices.data(), BUFFER_STATIC);
+    }
+    else
+        EBO = renderDevice.createBuffer(indices.size() * sizeof(unsigned int), indices.data(), BUFFER_STATIC);
+    renderDevice.setElementBuffer(VAO, EBO);
+}
+
+void PanelGroups::setGroup(unsigned int group, float offsetX, float offsetY, float opacity)
+{
+    if (group < groups.size())
+        groups[group].data = { offsetX, offsetY, opacity, 0.0f };
+}
+
+void PanelGroups::setVisible(unsigned int group, bool visible)
+{
+    if (group < groups.size())
+        groups[group].visible = visible;
+}
+
+void PanelGroups::draw()
+{
+    PROFILE_ZONE("PanelGroups::draw");
+    commands.clear();
+    drawData.clear();
+    for (const Group& group : groups)
+    {
+        if (!group.visible || group.quads == 0)
+            continue;
+        DrawElementsIndirectCommand command;
+        command.count = group.quads * 6;
+        command.instanceCount = 1;
+        command.firstIndex = 0;
+        command.baseVertex = (int32_t)group.firstVertex;
+        command.baseInstance = (uint32_t)drawData.size();
+        commands.push_back(command);
+        drawData.push_back(group.data);
+    }
+    if (commands.empty())
+        return;
+
+    StreamAllocation data = stream.map(drawData.size() * sizeof(GroupDrawData));
+    if (!data.data)
+        return;
+    memcpy(data.data, drawData.data(), drawData.size() * sizeof(GroupDrawData));
+    stream.unmap();
+
+    glState.bindVertexArray(VAO);
+    if (indirect)
+    {
+        StreamAllocation records = stream.map(commands.size() * sizeof(DrawElementsIndirectCommand));
+        if (!records.data)
+            return;
+        memcpy(records.data, commands.data(), commands.size() * sizeof(DrawElementsIndirectCommand));
+        stream.unmap();
+        // base instance i reads element i of the draw data
+        renderDevice.setVertexBuffer(VAO, DRAW_DATA_BINDING, data.buffer, data.offset, drawDataLayout());
+        glState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, records.buffer);
+        glExt.multiDrawElementsIndirect(GL_TRIANGLES, indexType, (const void*)(uintptr_t)records.offset,
+            (GLsizei)commands.size(), 0);
+        return;
+    }
+
+    // without a base instance every draw starts reading at the binding's offset
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    for (const DrawElementsIndirectCommand& command : commands)
+    {
+        renderDevice.setVertexBuffer(VAO, DRAW_DATA_BINDING, data.buffer,
+            data.offset + command.baseInstance * sizeof(GroupDrawData), drawDataLayout());
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, indexType,
+            (const void*)(uintptr_t)(command.firstIndex * indexSize), command.instanceCount, command.baseVertex);
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "QuadBatch.h"
+#include "StreamBuffer.h"
+#include "VertexFormat.h"
+
+// Like quadBatchVertexShader(QUAD_VERTEX_FLOAT), plus the offset and opacity of the panel's group, with inputs
+// generated from PanelGroups' vertex layouts. Goes with quadBatchFragmentShaderSource.
+std::string panelGroupsVertexShader();
+
+// The record glMultiDrawElementsIndirect reads for every draw, laid out as OpenGL defines it.
+struct DrawElementsIndirectCommand
+{
+    uint32_t count;         // indices
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;     // added to every index
+    uint32_t baseInstance;  // where per-instance attributes start
+};
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand must match the GL layout");
+
+// Per-draw data of a group, read by the vertex shader as one vec4.
+struct GroupDrawData
+{
+    float offsetX, offsetY; // moves every panel of the group, in normalized device coordinates
+    float opacity;          // multiplies the alpha of every panel
+    float unused;
+};
+
+/*
+Panels in groups (background, toolbars, content, ...) that are drawn with one call for all of them, while
+every group can still be moved, faded or hidden on its own without uploading its panels again.
+
+All groups share one vertex buffer, each group a range of it, and one index buffer with the index pattern
+of the biggest group: a group is drawn with firstIndex 0 and its first vertex as base vertex. Every frame
+draw() builds a DrawElementsIndirectCommand per visible group on the CPU, and writes them and the groups'
+GroupDrawData into a StreamBuffer. The data of draw i comes in through an attribute with a divisor of 1 and
+base instance i, so the shader gets it without gl_DrawID, which would need OpenGL 4.6.
+
+With multi-draw indirect (OpenGL 4.3) that is one glMultiDrawElementsIndirect for every group. On 3.3 the
+same commands are issued one by one with glDrawElementsInstancedBaseVertex, which has no base instance, so
+the per-draw attribute is pointed at each draw's data before its draw instead.
+*/
+class PanelGroups
+{
+public:
+    // indirectIfSupported = false always takes the 3.3 path, e.g. to compare the two.
+    void init(bool indirectIfSupported = true);
+    void destroy();
+
+    // Forgets every group.
+    void clear();
+    // Starts a new group, the panels submitted from now on belong to it. Returns the group's id.
+    unsigned int beginGroup();
+    void submit(const Panel& panel);
+    // Uploads the panels of every group. Call once after submitting, not every frame.
+    void end();
+
+    void setGroup(unsigned int group, float offsetX, float offsetY, float opacity);
+    void setVisible(unsigned int group, bool visible);
+
+    // Draws every visible group with the currently bound program, in the order the groups were begun.
+    void draw();
+
+    unsigned int groupCount() const { return (unsigned int)groups.size(); }
+    bool usesIndirect() const { return indirect; }
+
+    // Position and color per vertex, the GroupDrawData per instance, for the RenderDevice and the shader.
+    static const VertexLayout& vertexLayout();
+    static const VertexLayout& drawDataLayout();
+
+private:
+    struct Vertex
+    {
+        float x, y;
+        float r, g, b, a;
+    };
+    struct Group
+    {
+        unsigned int firstVertex = 0;
+        unsigned int quads = 0;
+        GroupDrawData data = { 0.0f, 0.0f, 1.0f, 0.0f };
+        bool visible = true;
+    };
+
+    std::vector<Vertex> vertices;
+    std::vector<Group> groups;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<GroupDrawData> drawData;
+    StreamBuffer stream;
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    GLenum indexType = GL_UNSIGNED_SHORT;
+    bool indirect = false;
+};
@@ -0,0 +1,91 @@
+#include <glad/glad.h>
+#include <iostream>
+
+#include "GLState.h"
+#include "PartialRedraw.h"
+
+void PartialRedraw::init(PresentMode preferred, BufferAgeQuery query, void* queryUser)
+{
+    presentMode = preferred;
+    bufferAge = query;
+    bufferAgeUser = queryUser;
+    if (presentMode == PRESENT_BUFFER_AGE && !bufferAge)
+        presentMode = PRESENT_RETAINED;
+}
+
+void PartialRedraw::destroy()
+{
+    if (FBO)
+        glState.deleteFramebuffer(FBO);
+    if (colorBuffer)
+        glDeleteRenderbuffers(1, &colorBuffer);
+    FBO = colorBuffer = 0;
+    retainedValid = false;
+}
+
+void PartialRedraw::resize(int newWidth, int newHeight)
+{
+    if (newWidth == width && newHeight == height)
+        return;
+    width = newWidth;
+    height = newHeight;
+    if (presentMode == PRESENT_RETAINED && !createFramebuffer())
+    {
+        std::cout << "ERROR::FRAMEBUFFER::NOT_COMPLETE, falling back to full repaints" << std::endl;
+        destroy();
+        presentMode = PRESENT_FULL;
+    }
+}
+
+bool PartialRedraw::createFramebuffer()
+{
+    destroy();
+    if (width <= 0 || height <= 0)
+        return true;
+
+    glGenFramebuffers(1, &FBO);
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glState.bindFramebuffer(FBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glState.bindFramebuffer(0);
+    return complete;
+}
+
+bool PartialRedraw::beginFrame(const DamageTracker& damage, std::vector<PixelRect>& regions)
+{
+    regions.clear();
+    switch (presentMode)
+    {
+    case PRESENT_RETAINED:
+        glState.bindFramebuffer(FBO);
+        if (!retainedValid)
+        {
+            // first frame after (re)creating it, the framebuffer holds nothing yet
+            retainedValid = true;
+            return false;
+        }
+        return damage.regionsForBufferAge(1, regions);
+    case PRESENT_BUFFER_AGE:
+        glState.bindFramebuffer(0);
+        return damage.regionsForBufferAge((unsigned int)bufferAge(bufferAgeUser), regions);
+    default:
+        glState.bindFramebuffer(0);
+        return false;
+    }
+}
+
+void PartialRedraw::endFrame()
+{
+    if (presentMode != PRESENT_RETAINED || !FBO)
+        return;
+    // glBlitFramebuffer respects the scissor test
+    glState.setScissorTest(false);
+    glState.bindReadFramebuffer(FBO);
+    glState.bindDrawFramebuffer(0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+#include "DamageTracker.h"
+
+enum PresentMode
+{
+    PRESENT_FULL,       // repaint everything every frame
+    PRESENT_RETAINED,   // draw into an offscreen framebuffer that keeps its contents, then copy it to the window
+    PRESENT_BUFFER_AGE  // draw straight into the back buffer, the windowing system tells us how old its contents are
+};
+
+// Returns the age of the current back buffer (EGL_BUFFER_AGE_EXT style), 0 if unknown.
+typedef int (*BufferAgeQuery)(void* user);
+
+/*
+Decides where a frame is drawn and which parts of it have to be redrawn.
+
+After glfwSwapBuffers the contents of the window's back buffer are undefined, so without help from the
+windowing system only a full repaint is safe. PRESENT_BUFFER_AGE uses that help when a backend can query the
+buffer age. Otherwise PRESENT_RETAINED keeps our own copy of the last frame in a framebuffer object: only the
+damaged regions are redrawn into it and the finished picture is copied to the window with one glBlitFramebuffer,
+which costs far less than drawing every panel again.
+*/
+class PartialRedraw
+{
+public:
+    // Falls back to PRESENT_FULL when the mode isn't available.
+    void init(PresentMode preferred, BufferAgeQuery query = nullptr, void* queryUser = nullptr);
+    void destroy();
+    void resize(int width, int height);
+    PresentMode mode() const { return presentMode; }
+
+    /*
+    Binds the framebuffer to draw into and fills regions with the scissor rectangles to redraw.
+    Returns false if the whole frame has to be repainted. An empty list with true means nothing changed,
+    e.g. the window was only uncovered, and the frame just has to be presented again.
+    */
+    bool beginFrame(const DamageTracker& damage, std::vector<PixelRect>& regions);
+    // Copies the retained framebuffer to the window. Call before swapping buffers.
+    void endFrame();
+
+private:
+    bool createFramebuffer();
+
+    PresentMode presentMode = PRESENT_FULL;
+    BufferAgeQuery bufferAge = nullptr;
+    void* bufferAgeUser = nullptr;
+    int width = 0, height = 0;
+    unsigned int FBO = 0, colorBuffer = 0;
+    bool retainedValid = false;
+};
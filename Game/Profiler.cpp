@@ -0,0 +1,98 @@
+#include "Profiler.h"
+#include <cstdio>
+#include <iostream>
+
+Profiler profiler;
+
+void Profiler::start()
+{
+    epoch = std::chrono::steady_clock::now();
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+uint64_t Profiler::now() const
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+Profiler::ThreadRing* Profiler::threadRing()
+{
+    // Rings are never freed, so a thread that exited still shows up in the trace.
+    thread_local ThreadRing* ring = nullptr;
+    if (!ring)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        rings.emplace_back(new ThreadRing);
+        ring = rings.back().get();
+        ring->id = (unsigned int)rings.size();
+    }
+    return ring;
+}
+
+void Profiler::record(const char* name, uint64_t begin, uint64_t end)
+{
+    ThreadRing* ring = threadRing();
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    ring->events[head % PROFILE_RING_SIZE] = { name, begin, end };
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::setThreadName(const char* name)
+{
+    threadRing()->name = name;
+}
+
+unsigned int Profiler::addLane(const char* name)
+{
+    // a ring that no thread records into on its own, shown like one more thread
+    std::lock_guard<std::mutex> lock(registryMutex);
+    rings.emplace_back(new ThreadRing);
+    rings.back()->id = (unsigned int)rings.size();
+    rings.back()->name = name;
+    return rings.back()->id;
+}
+
+void Profiler::recordLane(unsigned int lane, const char* name, uint64_t begin, uint64_t end)
+{
+    // lanes are for rare events, so taking the lock is fine
+    std::lock_guard<std::mutex> lock(registryMutex);
+    ThreadRing* ring = rings[lane - 1].get();
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    ring->events[head % PROFILE_RING_SIZE] = { name, begin, end };
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+bool Profiler::exportChromeTrace(const char* path) const
+{
+    FILE* file = fopen(path, "w");
+    if (!file)
+    {
+        std::cout << "ERROR::PROFILER::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    bool first = true;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const std::unique_ptr<ThreadRing>& ring : rings)
+    {
+        if (ring->name)
+        {
+            fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",", ring->id, ring->name);
+            first = false;
+        }
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t count = head < PROFILE_RING_SIZE ? head : PROFILE_RING_SIZE;
+        for (uint64_t i = head - count; i < head; i++)
+        {
+            // complete events, timestamps in microseconds
+            const ProfileEvent& event = ring->events[i % PROFILE_RING_SIZE];
+            fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                first ? "" : ",", event.name, ring->id, event.begin / 1000.0, (event.end - event.begin) / 1000.0);
+            first = false;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return true;
+}
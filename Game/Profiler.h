@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Zones each thread keeps. When a ring is full the oldest zones are overwritten.
+const unsigned int PROFILE_RING_SIZE = 1 << 16;
+
+struct ProfileEvent
+{
+    const char* name;   // must outlive the profiler, i.e. a string literal
+    uint64_t begin, end; // nanoseconds since Profiler::start()
+};
+
+/*
+Records named zones of time and writes them as a Chrome trace (chrome://tracing, ui.perfetto.dev).
+Every thread writes into its own ring buffer, which only it ever writes to, so recording a zone takes
+no lock and no atomic read-modify-write: the event is stored and the ring's head is published with a
+release store. Only the first zone of a new thread takes a lock, to register its ring.
+While the profiler isn't started a zone costs one relaxed atomic load.
+*/
+class Profiler
+{
+public:
+    void start();
+    void stop() { enabled.store(false, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    // Nanoseconds since start().
+    uint64_t now() const;
+    void record(const char* name, uint64_t begin, uint64_t end);
+    // Names the calling thread in the trace.
+    void setThreadName(const char* name);
+    // A row of its own in the trace for work that doesn't run on one of our threads, e.g. a shader the driver
+    // compiles in the background. Zones in a lane may be recorded by any thread, but must not overlap.
+    unsigned int addLane(const char* name);
+    void recordLane(unsigned int lane, const char* name, uint64_t begin, uint64_t end);
+
+    // Best called while no other thread records, a ring being written during the export may
+    // contribute a few garbled zones at its oldest end.
+    bool exportChromeTrace(const char* path) const;
+
+private:
+    struct ThreadRing
+    {
+        unsigned int id = 0;
+        const char* name = nullptr;
+        std::atomic<uint64_t> head{ 0 };
+        ProfileEvent events[PROFILE_RING_SIZE];
+    };
+    ThreadRing* threadRing();
+
+    std::atomic<bool> enabled{ false };
+    std::chrono::steady_clock::time_point epoch;
+    mutable std::mutex registryMutex;
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+};
+
+extern Profiler profiler;
+
+// Records the time between its construction and destruction as one zone.
+class ProfileZone
+{
+public:
+    explicit ProfileZone(const char* name)
+        : name(name), active(profiler.isEnabled()), begin(active ? profiler.now() : 0)
+    {
+    }
+    ~ProfileZone()
+    {
+        if (active)
+            profiler.record(name, begin, profiler.now());
+    }
+
+private:
+    const char* name;
+    bool active;
+    uint64_t begin;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Profiles the rest of the enclosing scope. name has to be a string literal.
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
@@ -0,0 +1,200 @@
+#include "ProgramCache.h"
+#include "GLExtensions.h"
+#include "Profiler.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+ProgramCache programCache;
+
+// Start of every cache file, followed by length bytes of binary.
+struct EntryHeader
+{
+    char magic[4];    // "GLPB"
+    uint32_t format;  // binary format glGetProgramBinary returned
+    uint32_t length;
+    uint32_t unused;
+    uint64_t key;     // the hash the file is named after, in case files get renamed or copied around
+};
+
+// 64 bit FNV-1a, continuing from hash. Includes the terminating zero so "ab" + "c" and "a" + "bc" differ.
+static uint64_t hashString(uint64_t hash, const char* text)
+{
+    const char* c = text ? text : "";
+    do
+    {
+        hash ^= (unsigned char)*c;
+        hash *= 1099511628211ull;
+    } while (*c++);
+    return hash;
+}
+
+static uint64_t entryKey(uint64_t driverHash, const char* vertexSource, const char* fragmentSource)
+{
+    return hashString(hashString(driverHash, vertexSource), fragmentSource);
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool ProgramCache::init(const char* cacheDirectory)
+{
+    shutdown();
+    if (!glExt.programBinary)
+        return false;
+#ifdef _WIN32
+    int made = _mkdir(cacheDirectory);
+#else
+    int made = mkdir(cacheDirectory, 0755);
+#endif
+    if (made != 0 && errno != EEXIST)
+    {
+        std::cout << "ERROR::PROGRAM_CACHE::CANNOT_CREATE_DIRECTORY " << cacheDirectory << std::endl;
+        return false;
+    }
+    directory = cacheDirectory;
+    driverHash = 14695981039346656037ull;
+    driverHash = hashString(driverHash, (const char*)glGetString(GL_VENDOR));
+    driverHash = hashString(driverHash, (const char*)glGetString(GL_RENDERER));
+    driverHash = hashString(driverHash, (const char*)glGetString(GL_VERSION));
+    enabled = true;
+    return true;
+}
+
+void ProgramCache::shutdown()
+{
+    enabled = false;
+    directory.clear();
+}
+
+std::string ProgramCache::entryPath(const char* vertexSource, const char* fragmentSource) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)entryKey(driverHash, vertexSource, fragmentSource));
+    return directory + name;
+}
+
+unsigned int ProgramCache::load(const char* vertexSource, const char* fragmentSource, bool separable)
+{
+    if (!enabled)
+        return 0;
+    PROFILE_ZONE("ProgramCache::load");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::string path = entryPath(vertexSource, fragmentSource);
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return 0;
+
+    EntryHeader header;
+    std::vector<char> binary;
+    bool readable = fread(&header, sizeof(header), 1, file) == 1
+        && memcmp(header.magic, "GLPB", 4) == 0
+        && header.key == entryKey(driverHash, vertexSource, fragmentSource)
+        && header.length > 0;
+    if (readable)
+    {
+        binary.resize(header.length);
+        readable = fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+    if (!readable)
+    {
+        // cut short or not ours, it gets written again once the program is built
+        std::remove(path.c_str());
+        return 0;
+    }
+
+    unsigned int program = glCreateProgram();
+    // not every driver keeps this in the binary
+    if (separable)
+        glExt.programParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    glExt.programBinaryLoad(program, header.format, binary.data(), (GLsizei)binary.size());
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        // not an error, the driver is free to reject binaries whenever it likes
+        glDeleteProgram(program);
+        std::remove(path.c_str());
+        stats.rejected++;
+        return 0;
+    }
+    stats.loaded++;
+    stats.loadMs += millisecondsSince(start);
+    return program;
+}
+
+void ProgramCache::prepareLink(unsigned int program)
+{
+    if (enabled)
+        glExt.programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ProgramCache::store(unsigned int program, const char* vertexSource, const char* fragmentSource, double buildMs)
+{
+    stats.built++;
+    stats.buildMs += buildMs;
+    if (!enabled)
+        return;
+    PROFILE_ZONE("ProgramCache::store");
+
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glExt.getProgramBinary(program, length, &length, &format, binary.data());
+    if (length <= 0)
+        return;
+
+    EntryHeader header;
+    memcpy(header.magic, "GLPB", 4);
+    header.format = format;
+    header.length = (uint32_t)length;
+    header.unused = 0;
+    header.key = entryKey(driverHash, vertexSource, fragmentSource);
+
+    // Written under a temporary name first, so a crash halfway never leaves a broken entry behind.
+    std::string path = entryPath(vertexSource, fragmentSource);
+    std::string temporary = path + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (!file)
+    {
+        std::cout << "ERROR::PROGRAM_CACHE::CANNOT_WRITE " << temporary << std::endl;
+        return;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(binary.data(), 1, (size_t)length, file) == (size_t)length;
+    written = fclose(file) == 0 && written;
+    // rename doesn't replace an existing file on Windows
+    std::remove(path.c_str());
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        std::cout << "ERROR::PROGRAM_CACHE::CANNOT_WRITE " << path << std::endl;
+        std::remove(temporary.c_str());
+    }
+}
+
+void ProgramCache::remove(const char* vertexSource, const char* fragmentSource)
+{
+    if (enabled)
+        std::remove(entryPath(vertexSource, fragmentSource).c_str());
+}
+
+void ProgramCache::printStats() const
+{
+    printf("Programs: %u from cache in %.2f ms, %u built in %.2f ms, %u rejected%s\n",
+        stats.loaded, stats.loadMs, stats.built, stats.buildMs, stats.rejected,
+        enabled ? "" : " (program cache off)");
+}
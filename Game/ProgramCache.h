@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct ProgramCacheStats
+{
+    unsigned int loaded;   // programs created from a saved binary
+    unsigned int built;    // programs compiled and linked from source
+    unsigned int rejected; // saved binaries the driver refused, e.g. after a driver update it didn't announce
+    double loadMs;         // time spent creating programs from binaries
+    double buildMs;        // time spent compiling and linking
+};
+
+/*
+Keeps linked programs on disk so the next start doesn't have to compile and link them again.
+createProgram() asks the cache first and hands every program it had to build to store().
+
+A binary is only valid for the exact driver that produced it, so the file name is a hash of the shader
+sources together with GL_VENDOR, GL_RENDERER and GL_VERSION. Anything else that changes, like a driver
+update that keeps its version string, shows up as a failed glProgramBinary: the file is deleted and the
+program built from source as if there had been no cache.
+Without program binary support in the driver the cache simply stays off.
+*/
+class ProgramCache
+{
+public:
+    // Turns the cache on, creating the directory if needed. glExt must already be loaded.
+    bool init(const char* directory);
+    void shutdown();
+    bool isEnabled() const { return enabled; }
+
+    // 0 if there is no saved binary for these sources, or the driver didn't accept it.
+    // A separable program has the source of its one stage and an empty string for the other.
+    unsigned int load(const char* vertexSource, const char* fragmentSource, bool separable = false);
+    // Must be called before glLinkProgram, some drivers don't keep the binary around otherwise.
+    void prepareLink(unsigned int program);
+    // Saves a program that was linked from these sources. buildMs is how long that took, for the stats.
+    void store(unsigned int program, const char* vertexSource, const char* fragmentSource, double buildMs);
+    // Deletes the saved binary of these sources, if any.
+    void remove(const char* vertexSource, const char* fragmentSource);
+
+    const ProgramCacheStats& getStats() const { return stats; }
+    void resetStats() { stats = ProgramCacheStats(); }
+    void printStats() const;
+
+private:
+    std::string entryPath(const char* vertexSource, const char* fragmentSource) const;
+
+    bool enabled = false;
+    std::string directory;
+    // hash of the vendor, renderer and version strings
+    uint64_t driverHash = 0;
+    ProgramCacheStats stats = ProgramCacheStats();
+};
+
+extern ProgramCache programCache;
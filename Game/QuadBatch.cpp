@@ -0,0 +1,162 @@
+#include "QuadBatch.h"
+#include "GLState.h"
+#include "Profiler.h"
+#include "RenderDevice.h"
+#include <cstddef>
+
+// The vertex shader without its inputs, which quadBatchVertexShader() generates for a format.
+static const char* quadBatchVertexShaderBody =
+"out vec4 vColor;\n"
+"void main()\n"
+"{\n"
+"   gl_Position = vec4(aPos.x, aPos.y, 0.0, 1.0);\n"
+"   vColor = aColor;\n"
+"}\n";
+
+const char* quadBatchFragmentShaderSource = "#version 330 core\n"
+"in vec4 vColor;\n"
+"out vec4 FragColor;\n"
+"void main()\n"
+"{\n"
+"   FragColor = vColor;\n"
+"}\n\0";
+
+template <typename Index>
+static void fillQuadIndices(std::vector<Index>& indices, unsigned int quads)
+{
+    indices.resize(quads * 6);
+    for (unsigned int i = 0; i < quads; i++)
+    {
+        Index v = (Index)(i * 4);
+        indices[i * 6 + 0] = v + 0;
+        indices[i * 6 + 1] = v + 1;
+        indices[i * 6 + 2] = v + 2;
+        indices[i * 6 + 3] = v + 2;
+        indices[i * 6 + 4] = v + 3;
+        indices[i * 6 + 5] = v + 0;
+    }
+}
+
+const VertexLayout& QuadBatch::vertexLayout(QuadVertexFormat format)
+{
+    static const VertexAttribute attributes[] = {
+        { 0, 2, GL_FLOAT, false, false, offsetof(Vertex, x), "aPos" },
+        { 1, 4, GL_FLOAT, false, false, offsetof(Vertex, r), "aColor" }
+    };
+    static const VertexLayout layout = { attributes, 2, sizeof(Vertex), 0 };
+    // the same inputs in 8 bytes instead of 24
+    static const VertexAttribute packedAttributes[] = {
+        { 0, 2, GL_SHORT, true, false, offsetof(PackedVertex, x), "aPos" },
+        { 1, 4, GL_UNSIGNED_BYTE, true, false, offsetof(PackedVertex, color), "aColor" }
+    };
+    static const VertexLayout packedLayout = { packedAttributes, 2, sizeof(PackedVertex), 0 };
+    return format == QUAD_VERTEX_PACKED ? packedLayout : layout;
+}
+
+std::string quadBatchVertexShader(QuadVertexFormat format)
+{
+    return std::string("#version 330 core\n") + vertexInputsGLSL(QuadBatch::vertexLayout(format)) + quadBatchVertexShaderBody;
+}
+
+void QuadBatch::init(unsigned int initialQuads, QuadVertexFormat vertexFormat)
+{
+    format = vertexFormat;
+    VAO = renderDevice.createVertexArray();
+    renderDevice.setVertexFormat(VAO, 0, vertexLayout(format));
+    reserve(initialQuads > 0 ? initialQuads : 1);
+}
+
+void QuadBatch::destroy()
+{
+    glState.deleteVertexArray(VAO);
+    glState.deleteBuffer(VBO);
+    glState.deleteBuffer(EBO);
+    VAO = VBO = EBO = 0;
+    capacity = 0;
+    uploadedQuads = 0;
+}
+
+void QuadBatch::begin()
+{
+    vertices.clear();
+    packedVertices.clear();
+}
+
+void QuadBatch::submit(const Panel& p)
+{
+    // Two triangles share the diagonal, so a quad only needs 4 vertices:
+    //  1---2
+    //  | / |
+    //  0---3
+    if (format == QUAD_VERTEX_PACKED)
+    {
+        int16_t x0 = packNormalizedShort(p.x), x1 = packNormalizedShort(p.x + p.w);
+        int16_t y0 = packNormalizedShort(p.y), y1 = packNormalizedShort(p.y + p.h);
+        uint32_t color = packColor(p.r, p.g, p.b, p.a);
+        packedVertices.push_back({ x0, y0, color });
+        packedVertices.push_back({ x0, y1, color });
+        packedVertices.push_back({ x1, y1, color });
+        packedVertices.push_back({ x1, y0, color });
+        return;
+    }
+    vertices.push_back({ p.x,       p.y,       p.r, p.g, p.b, p.a });
+    vertices.push_back({ p.x,       p.y + p.h, p.r, p.g, p.b, p.a });
+    vertices.push_back({ p.x + p.w, p.y + p.h, p.r, p.g, p.b, p.a });
+    vertices.push_back({ p.x + p.w, p.y,       p.r, p.g, p.b, p.a });
+}
+
+void QuadBatch::end()
+{
+    PROFILE_ZONE("QuadBatch::end");
+    unsigned int quads = quadCount();
+    if (quads > capacity)
+        reserve(quads * 2);
+
+    // One upload for the whole batch instead of one buffer per shape.
+    if (format == QUAD_VERTEX_PACKED)
+        renderDevice.updateBuffer(VBO, 0, packedVertices.size() * sizeof(PackedVertex), packedVertices.data());
+    else
+        renderDevice.updateBuffer(VBO, 0, vertices.size() * sizeof(Vertex), vertices.data());
+    uploadedQuads = quads;
+}
+
+void QuadBatch::draw() const
+{
+    if (uploadedQuads == 0)
+        return;
+    glState.bindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, uploadedQuads * 6, indexType, 0);
+}
+
+void QuadBatch::reserve(unsigned int quads)
+{
+    capacity = quads;
+
+    // buffers can't grow, bigger ones take the place of the old ones
+    if (VBO)
+    {
+        glState.deleteBuffer(VBO);
+        glState.deleteBuffer(EBO);
+    }
+    const VertexLayout& layout = vertexLayout(format);
+    VBO = renderDevice.createBuffer(capacity * 4 * layout.stride, NULL, BUFFER_DYNAMIC);
+    renderDevice.setVertexBuffer(VAO, 0, VBO, 0, layout);
+
+    // The index pattern is the same for every quad, so it is generated once per capacity change.
+    // While every vertex can be addressed with 16 bits the indices take half the space.
+    indexType = capacity * 4 <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    if (indexType == GL_UNSIGNED_SHORT)
+    {
+        std::vector<unsigned short> indices;
+        fillQuadIndices(indices, capacity);
+        EBO = renderDevice.createBuffer(indices.size() * sizeof(unsigned short), indices.data(), BUFFER_STATIC);
+    }
+    else
+    {
+        std::vector<unsigned int> indices;
+        fillQuadIndices(indices, capacity);
+        EBO = renderDevice.createBuffer(indices.size() * sizeof(unsigned int), indices.data(), BUFFER_STATIC);
+    }
+    // the EBO is part of the VAO state
+    renderDevice.setElementBuffer(VAO, EBO);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "VertexFormat.h"
+
+// A rectangle in normalized device coordinates (x, y is the bottom left corner)
+// together with its fill color.
+struct Panel
+{
+    float x, y, w, h;
+    float r, g, b, a;
+};
+
+// What a QuadBatch vertex is stored as.
+enum QuadVertexFormat
+{
+    QUAD_VERTEX_FLOAT, // float position and color, 24 bytes
+    // Normalized GL_SHORT position and GL_UNSIGNED_BYTE color, 8 bytes. Positions are clamped to -1..1,
+    // which is plenty for panels on screen and a third of the vertex fetch and buffer memory.
+    QUAD_VERTEX_PACKED
+};
+
+// OpenGL Shading Language
+// Every panel carries its own color as a vertex attribute, so a single program draws all of them.
+// The vertex shader for a format, with inputs generated from its vertex layout.
+std::string quadBatchVertexShader(QuadVertexFormat format);
+extern const char* quadBatchFragmentShaderSource;
+
+/*
+Collects panels into one CPU-side vertex stream and draws all of them with a single glDrawElements call.
+Every panel becomes 4 vertices carrying their own color, so the whole batch only needs one program,
+one VAO and one draw call no matter how many panels (or colors) there are.
+Panels are drawn in the order they were submitted, so later panels end up on top of earlier ones.
+*/
+class QuadBatch
+{
+public:
+    // Creates the VAO, VBO and EBO with room for initialQuads panels. The buffers grow when needed.
+    // The program drawing the batch needs the vertex shader of the same format.
+    void init(unsigned int initialQuads, QuadVertexFormat format = QUAD_VERTEX_FLOAT);
+    void destroy();
+
+    // Starts a new batch, forgetting every panel submitted before.
+    void begin();
+    void submit(const Panel& panel);
+    // Uploads the vertex stream to the GPU. Call once after submitting, not every frame.
+    void end();
+    // Draws every panel with the currently bound program.
+    void draw() const;
+
+    unsigned int quadCount() const { return (unsigned int)((format == QUAD_VERTEX_PACKED ? packedVertices.size() : vertices.size()) / 4); }
+
+    // Attributes 0 and 1 of the format, position and color.
+    static const VertexLayout& vertexLayout(QuadVertexFormat format);
+
+private:
+    struct Vertex
+    {
+        float x, y;
+        float r, g, b, a;
+    };
+    struct PackedVertex
+    {
+        int16_t x, y;   // packNormalizedShort()
+        uint32_t color; // packColor()
+    };
+    static_assert(sizeof(PackedVertex) == 8, "PackedVertex must stay 8 bytes");
+
+    void reserve(unsigned int quads);
+
+    QuadVertexFormat format = QUAD_VERTEX_FLOAT;
+    std::vector<Vertex> vertices;
+    std::vector<PackedVertex> packedVertices;
+    unsigned int capacity = 0;
+    unsigned int uploadedQuads = 0;
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+};
@@ -0,0 +1,50 @@
+#include <GLFW/glfw3.h>
+
+#include "Redraw.h"
+
+RedrawScheduler redraw;
+
+void RedrawScheduler::markDirty(unsigned int reasons)
+{
+    if (dirty.fetch_or(reasons) == REDRAW_NONE)
+        glfwPostEmptyEvent();
+}
+
+void RedrawScheduler::scheduleFrameAt(double time)
+{
+    if (nextAnimationFrame < 0.0 || time < nextAnimationFrame)
+        nextAnimationFrame = time;
+}
+
+void RedrawScheduler::waitForEvents()
+{
+    if (continuous || dirty.load() != REDRAW_NONE)
+    {
+        glfwPollEvents();
+    }
+    else if (nextAnimationFrame >= 0.0)
+    {
+        double timeout = nextAnimationFrame - glfwGetTime();
+        if (timeout > 0.0)
+            glfwWaitEventsTimeout(timeout);
+        else
+            glfwPollEvents();
+    }
+    else
+    {
+        // Sleeps until the OS has an event for us (input, resize, expose) or glfwPostEmptyEvent is called.
+        glfwWaitEvents();
+    }
+    wakeupCount++;
+
+    if (nextAnimationFrame >= 0.0 && glfwGetTime() >= nextAnimationFrame)
+    {
+        nextAnimationFrame = -1.0;
+        dirty.fetch_or(REDRAW_ANIMATION);
+    }
+}
+
+void RedrawScheduler::frameDrawn()
+{
+    frames++;
+}
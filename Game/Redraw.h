@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+
+// Why a frame has to be drawn. Several reasons can be pending at once.
+enum RedrawReason
+{
+    REDRAW_NONE = 0,
+    REDRAW_EXPOSE = 1 << 0,    // the window contents were lost (first frame, uncovered, restored)
+    REDRAW_RESIZE = 1 << 1,
+    REDRAW_INPUT = 1 << 2,     // input changed something on screen
+    REDRAW_ANIMATION = 1 << 3, // a scheduled animation frame is due
+    REDRAW_DATA = 1 << 4       // the scene data changed
+};
+
+/*
+Decides when the render loop has to draw. In event-driven mode the loop sleeps in glfwWaitEvents until
+something marks the frame dirty, so a UI that doesn't change costs (almost) no CPU at all.
+Continuous mode draws every iteration like a game loop, which the benchmarks want.
+
+markDirty may be called from any thread, it wakes the main thread up with glfwPostEmptyEvent.
+*/
+class RedrawScheduler
+{
+public:
+    void setContinuous(bool enabled) { continuous = enabled; }
+    bool isContinuous() const { return continuous; }
+
+    void markDirty(unsigned int reasons);
+    // Asks for an animation frame at the given glfwGetTime() time. The earliest pending request wins.
+    void scheduleFrameAt(double time);
+
+    // Processes pending events. Blocks until there is something to draw unless the frame is already dirty.
+    void waitForEvents();
+    bool needsRedraw() const { return continuous || dirty.load() != REDRAW_NONE; }
+    // Takes the reasons for the frame about to be drawn. Call right after needsRedraw(): anything marked while
+    // the frame is being drawn stays pending and keeps the next iteration awake.
+    unsigned int beginFrame() { return dirty.exchange(REDRAW_NONE); }
+    // Call once the frame has been presented.
+    void frameDrawn();
+
+    unsigned long long framesDrawn() const { return frames; }
+    unsigned long long wakeups() const { return wakeupCount; }
+
+private:
+    std::atomic<unsigned int> dirty{ REDRAW_EXPOSE };
+    bool continuous = false;
+    double nextAnimationFrame = -1.0;
+    unsigned long long frames = 0;
+    unsigned long long wakeupCount = 0;
+};
+
+extern RedrawScheduler redraw;
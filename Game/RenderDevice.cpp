@@ -0,0 +1,131 @@
+#include <glad/glad.h>
+#include <cstdint>
+
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "RenderDevice.h"
+
+RenderDevice renderDevice;
+
+bool RenderDevice::usesDirectStateAccess() const
+{
+    return glExt.directStateAccess;
+}
+
+unsigned int RenderDevice::createBuffer(size_t size, const void* data, BufferUsage usage)
+{
+    // neither path accepts an empty buffer
+    if (size == 0)
+        size = 1;
+    unsigned int buffer = 0;
+    if (glExt.directStateAccess)
+    {
+        glExt.createBuffers(1, &buffer);
+        glExt.namedBufferStorage(buffer, size, data, usage == BUFFER_DYNAMIC ? GL_DYNAMIC_STORAGE_BIT : 0);
+        return buffer;
+    }
+    glGenBuffers(1, &buffer);
+    glState.bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, size, data, usage == BUFFER_DYNAMIC ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+    return buffer;
+}
+
+void RenderDevice::updateBuffer(unsigned int buffer, size_t offset, size_t size, const void* data)
+{
+    if (size == 0)
+        return;
+    if (glExt.directStateAccess)
+    {
+        glExt.namedBufferSubData(buffer, offset, size, data);
+        return;
+    }
+    glState.bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+}
+
+unsigned int RenderDevice::createVertexArray()
+{
+    unsigned int vertexArray = 0;
+    if (glExt.directStateAccess)
+        glExt.createVertexArrays(1, &vertexArray);
+    else
+        glGenVertexArrays(1, &vertexArray);
+    return vertexArray;
+}
+
+void RenderDevice::setVertexFormat(unsigned int vertexArray, unsigned int binding, const VertexLayout& layout)
+{
+    if (glExt.directStateAccess)
+    {
+        for (unsigned int i = 0; i < layout.attributeCount; i++)
+        {
+            const VertexAttribute& attribute = layout.attributes[i];
+            if (attribute.integer)
+                glExt.vertexArrayAttribIFormat(vertexArray, attribute.location, attribute.size, attribute.type, attribute.offset);
+            else
+                glExt.vertexArrayAttribFormat(vertexArray, attribute.location, attribute.size, attribute.type,
+                    attribute.normalized ? GL_TRUE : GL_FALSE, attribute.offset);
+            glExt.vertexArrayAttribBinding(vertexArray, attribute.location, binding);
+            glExt.enableVertexArrayAttrib(vertexArray, attribute.location);
+        }
+        glExt.vertexArrayBindingDivisor(vertexArray, binding, layout.divisor);
+        return;
+    }
+    // 3.3 has no bindings, the format is given per attribute together with the buffer in setVertexBuffer()
+    beginEdit(vertexArray);
+    for (unsigned int i = 0; i < layout.attributeCount; i++)
+    {
+        glEnableVertexAttribArray(layout.attributes[i].location);
+        glVertexAttribDivisor(layout.attributes[i].location, layout.divisor);
+    }
+    endEdit();
+}
+
+void RenderDevice::setVertexBuffer(unsigned int vertexArray, unsigned int binding, unsigned int buffer, size_t offset, const VertexLayout& layout)
+{
+    if (glExt.directStateAccess)
+    {
+        glExt.vertexArrayVertexBuffer(vertexArray, binding, buffer, offset, layout.stride);
+        return;
+    }
+    beginEdit(vertexArray);
+    glState.bindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (unsigned int i = 0; i < layout.attributeCount; i++)
+    {
+        const VertexAttribute& attribute = layout.attributes[i];
+        const void* pointer = (const void*)(uintptr_t)(offset + attribute.offset);
+        if (attribute.integer)
+            glVertexAttribIPointer(attribute.location, attribute.size, attribute.type, layout.stride, pointer);
+        else
+            glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized ? GL_TRUE : GL_FALSE,
+                layout.stride, pointer);
+    }
+    endEdit();
+}
+
+void RenderDevice::setElementBuffer(unsigned int vertexArray, unsigned int buffer)
+{
+    // the element buffer of the bound VAO is cached by glState, so that one is changed through it either way
+    if (glExt.directStateAccess && glState.boundVertexArray() != vertexArray)
+    {
+        glExt.vertexArrayElementBuffer(vertexArray, buffer);
+        return;
+    }
+    beginEdit(vertexArray);
+    glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+    endEdit();
+}
+
+void RenderDevice::beginEdit(unsigned int vertexArray)
+{
+    previousVertexArray = glState.boundVertexArray();
+    previousArrayBuffer = glState.boundArrayBuffer();
+    glState.bindVertexArray(vertexArray);
+}
+
+void RenderDevice::endEdit()
+{
+    // nothing known to be bound before, 0 is as good as anything
+    glState.bindVertexArray(previousVertexArray == ~0u ? 0 : previousVertexArray);
+    glState.bindBuffer(GL_ARRAY_BUFFER, previousArrayBuffer == ~0u ? 0 : previousArrayBuffer);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+
+#include "VertexFormat.h"
+
+enum BufferUsage
+{
+    BUFFER_STATIC, // written once at creation
+    BUFFER_DYNAMIC // written again with updateBuffer()
+};
+
+/*
+Creates and edits buffers and vertex arrays.
+
+With OpenGL 4.5 or ARB_direct_state_access objects are edited by name: glCreateBuffers and glNamedBufferStorage
+make an immutable buffer the driver doesn't have to validate again at every draw, and the vertex format of a
+VAO is set once with glVertexArrayAttribFormat, separately from the buffer it reads, which
+glVertexArrayVertexBuffer can swap without touching the format. Nothing is bound, so creating an object in
+the middle of drawing something else can't disturb it.
+
+On plain OpenGL 3.3 the same calls bind to edit: buffers through GL_COPY_WRITE_BUFFER, which nothing draws
+from, and vertex arrays through glState, putting back the VAO and array buffer that were bound before.
+
+Either way buffers can't change size. A buffer that has to grow is replaced by a new one, and the vertex
+arrays reading it are pointed at that with setVertexBuffer() or setElementBuffer().
+*/
+class RenderDevice
+{
+public:
+    bool usesDirectStateAccess() const;
+
+    // A buffer of size bytes, filled with data unless it is null. Any buffer target can use it.
+    unsigned int createBuffer(size_t size, const void* data, BufferUsage usage);
+    // Writes size bytes at offset into a BUFFER_DYNAMIC buffer.
+    void updateBuffer(unsigned int buffer, size_t offset, size_t size, const void* data);
+
+    unsigned int createVertexArray();
+    // Sets up which attributes the binding feeds and how. Once per vertex array and binding.
+    void setVertexFormat(unsigned int vertexArray, unsigned int binding, const VertexLayout& layout);
+    // Points the binding at vertices starting at offset in buffer, with the layout setVertexFormat() was given.
+    void setVertexBuffer(unsigned int vertexArray, unsigned int binding, unsigned int buffer, size_t offset, const VertexLayout& layout);
+    void setElementBuffer(unsigned int vertexArray, unsigned int buffer);
+
+private:
+    // 3.3 path: binds the vertex array through glState and remembers what to put back.
+    void beginEdit(unsigned int vertexArray);
+    void endEdit();
+
+    unsigned int previousVertexArray = 0;
+    unsigned int previousArrayBuffer = 0;
+};
+
+// Used for every buffer and vertex array the game creates.
+extern RenderDevice renderDevice;
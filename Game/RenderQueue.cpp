@@ -0,0 +1,245 @@
+#include "RenderQueue.h"
+#include "GLState.h"
+#include <algorithm>
+#include <cstring>
+
+const unsigned int MAX_LAYER = 63;
+const unsigned int MAX_SUB_LAYER = 1023;
+const int GRID_SIZE = 16;
+// Earlier draws a cell remembers exactly. Keeps a submit from scanning every draw of a crowded cell.
+const unsigned int CELL_DRAWS = 64;
+
+void RenderQueue::clear()
+{
+    commands.clear();
+    subLayers.clear();
+    constantRanges.clear();
+    constantData.clear();
+    for (OverlapCell& cell : cells)
+    {
+        cell.draws.clear();
+        cell.minSubLayer = 0;
+    }
+    subLayerOverflow = false;
+}
+
+void RenderQueue::submit(const DrawCommand& command)
+{
+    if (!command.program && !command.pipeline)
+        return;
+    commands.push_back(command);
+    subLayers.push_back(overlapSubLayer((unsigned int)commands.size() - 1));
+    constantRanges.push_back({ 0, 0 });
+}
+
+void RenderQueue::submit(const DrawCommand& command, const void* constants, size_t size)
+{
+    if (!command.program && !command.pipeline)
+        return;
+    submit(command);
+    constantRanges.back() = { constantData.size(), size };
+    constantData.insert(constantData.end(), (const unsigned char*)constants, (const unsigned char*)constants + size);
+}
+
+void RenderQueue::uploadConstants()
+{
+    constantSlices.assign(commands.size(), UniformSlice());
+    if (constantData.empty())
+        return;
+    // every block at an offset glBindBufferRange accepts, all in one allocation
+    size_t total = 0;
+    for (const ConstantRange& range : constantRanges)
+        if (range.size)
+            total += uniformRing.align(range.size);
+    StreamAllocation allocation = uniformRing.map(total);
+    if (!allocation.data)
+        return;
+    size_t offset = 0;
+    for (size_t i = 0; i < commands.size(); i++)
+    {
+        const ConstantRange& range = constantRanges[i];
+        if (!range.size)
+            continue;
+        memcpy((unsigned char*)allocation.data + offset, &constantData[range.offset], range.size);
+        constantSlices[i].buffer = allocation.buffer;
+        constantSlices[i].offset = allocation.offset + offset;
+        constantSlices[i].size = range.size;
+        offset += uniformRing.align(range.size);
+    }
+    uniformRing.unmap();
+    stats.constantBytes = total;
+}
+
+static bool overlaps(const DrawCommand& a, const DrawCommand& b)
+{
+    return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+static int gridCell(float ndc)
+{
+    int cell = (int)((ndc + 1.0f) * 0.5f * GRID_SIZE);
+    return std::min(std::max(cell, 0), GRID_SIZE - 1);
+}
+
+unsigned int RenderQueue::overlapSubLayer(unsigned int index)
+{
+    // flush() draws this frame in submission order anyway
+    if (subLayerOverflow)
+        return 0;
+    const DrawCommand& command = commands[index];
+    int x0 = gridCell(command.x), x1 = gridCell(command.x + command.w);
+    int y0 = gridCell(command.y), y1 = gridCell(command.y + command.h);
+
+    // One above the highest earlier draw this one overlaps. Draws a cell no longer remembers are assumed
+    // to overlap, which can only put this one higher than needed.
+    unsigned int subLayer = 0;
+    for (int y = y0; y <= y1; y++)
+        for (int x = x0; x <= x1; x++)
+        {
+            const OverlapCell& cell = cells[y * GRID_SIZE + x];
+            subLayer = std::max(subLayer, cell.minSubLayer);
+            for (unsigned int other : cell.draws)
+                if (subLayers[other] + 1 > subLayer && overlaps(command, commands[other]))
+                    subLayer = subLayers[other] + 1;
+        }
+
+    for (int y = y0; y <= y1; y++)
+        for (int x = x0; x <= x1; x++)
+        {
+            OverlapCell& cell = cells[y * GRID_SIZE + x];
+            if (cell.draws.size() < CELL_DRAWS)
+            {
+                cell.draws.push_back(index);
+                continue;
+            }
+            // forget the draw with the lowest sub-layer, it is the one the least later draws could be sorted under
+            unsigned int lowest = 0;
+            for (unsigned int i = 1; i < CELL_DRAWS; i++)
+                if (subLayers[cell.draws[i]] < subLayers[cell.draws[lowest]])
+                    lowest = i;
+            cell.minSubLayer = std::max(cell.minSubLayer, subLayers[cell.draws[lowest]] + 1);
+            cell.draws[lowest] = index;
+        }
+
+    // Too many stacked draws to encode, flush() falls back to submission order for this frame.
+    if (subLayer > MAX_SUB_LAYER)
+        subLayerOverflow = true;
+    return subLayer;
+}
+
+uint64_t RenderQueue::makeKey(const DrawCommand& command, unsigned int subLayer) const
+{
+    float depth = std::min(std::max(command.depth, 0.0f), 1.0f);
+    uint64_t key = 0;
+    key |= (uint64_t)std::min(command.layer, MAX_LAYER) << 58;
+    key |= (uint64_t)subLayer << 48;
+    key |= (uint64_t)(command.translucent ? 1 : 0) << 47;
+    // Only the low bits of the GL names fit. A collision just means two states might not be grouped together.
+    key |= (uint64_t)((command.pipeline ? command.pipeline : command.program) & 1023) << 37;
+    key |= (uint64_t)(command.vertexArray & 1023) << 27;
+    key |= (uint64_t)(command.texture & 1023) << 17;
+    key |= (uint64_t)(depth * 131071.0f);
+    return key;
+}
+
+void RenderQueue::radixSort()
+{
+    // Least significant byte first. Every pass is stable, so draws with equal keys keep submission order.
+    size_t n = keys.size();
+    scratchKeys.resize(n);
+    scratchOrder.resize(n);
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        size_t counts[256] = { 0 };
+        for (size_t i = 0; i < n; i++)
+            counts[(keys[i] >> shift) & 0xFF]++;
+        // every key has the same byte here, nothing to do
+        if (counts[(keys[0] >> shift) & 0xFF] == n)
+            continue;
+
+        size_t offset = 0;
+        for (int bucket = 0; bucket < 256; bucket++)
+        {
+            size_t count = counts[bucket];
+            counts[bucket] = offset;
+            offset += count;
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            size_t destination = counts[(keys[i] >> shift) & 0xFF]++;
+            scratchKeys[destination] = keys[i];
+            scratchOrder[destination] = order[i];
+        }
+        keys.swap(scratchKeys);
+        order.swap(scratchOrder);
+    }
+}
+
+void RenderQueue::flush()
+{
+    stats = { 0, 0, 0, 0, 0 };
+    if (commands.empty())
+        return;
+    uploadConstants();
+
+    order.resize(commands.size());
+    for (unsigned int i = 0; i < (unsigned int)order.size(); i++)
+        order[i] = i;
+    if (!subLayerOverflow)
+    {
+        keys.resize(commands.size());
+        for (size_t i = 0; i < commands.size(); i++)
+            keys[i] = makeKey(commands[i], subLayers[i]);
+        radixSort();
+    }
+
+    unsigned int program = ~0u, pipeline = ~0u, vertexArray = ~0u, texture = ~0u;
+    for (unsigned int index : order)
+    {
+        const DrawCommand& command = commands[index];
+        if (command.program != program || command.pipeline != pipeline)
+        {
+            stats.programChanges++;
+            program = command.program;
+            pipeline = command.pipeline;
+        }
+        if (command.vertexArray != vertexArray)
+        {
+            stats.vertexArrayChanges++;
+            vertexArray = command.vertexArray;
+        }
+        if (command.texture != texture)
+        {
+            stats.textureChanges++;
+            texture = command.texture;
+        }
+
+        if (command.pipeline)
+            glState.bindProgramPipeline(command.pipeline);
+        else
+            glState.useProgram(command.program);
+        glState.bindVertexArray(command.vertexArray);
+        if (command.texture)
+            glState.bindTexture(0, command.texture);
+        if (constantSlices[index].buffer)
+            UniformRing::bind(DRAW_CONSTANTS_BINDING, constantSlices[index]);
+        glState.setBlend(command.translucent);
+        if (command.translucent)
+            glState.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        switch (command.kind)
+        {
+        case DRAW_ARRAYS:
+            glDrawArrays(command.mode, command.first, command.count);
+            break;
+        case DRAW_ELEMENTS:
+            glDrawElements(command.mode, command.count, command.indexType, (void*)(intptr_t)command.first);
+            break;
+        case DRAW_ARRAYS_INSTANCED:
+            glDrawArraysInstanced(command.mode, command.first, command.count, command.instanceCount);
+            break;
+        }
+        stats.draws++;
+    }
+    clear();
+}
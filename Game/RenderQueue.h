@@ -0,0 +1,107 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+
+#include "UniformRing.h"
+
+enum DrawKind
+{
+    DRAW_ARRAYS,
+    DRAW_ELEMENTS,
+    DRAW_ARRAYS_INSTANCED
+};
+
+// Everything needed to issue one draw call. The defaults describe an opaque draw covering the whole screen.
+struct DrawCommand
+{
+    unsigned int program = 0;
+    unsigned int pipeline = 0;    // program pipeline object, drawn with instead of program when not 0
+    unsigned int vertexArray = 0;
+    unsigned int texture = 0; // bound to texture unit 0 when not 0
+
+    DrawKind kind = DRAW_ARRAYS;
+    GLenum mode = GL_TRIANGLES;
+    int first = 0;            // first vertex, or byte offset into the element buffer for DRAW_ELEMENTS
+    int count = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    int instanceCount = 1;
+
+    // Where the draw lands on screen in normalized device coordinates. Draws that overlap
+    // are always drawn in the order they were submitted.
+    float x = -1.0f, y = -1.0f, w = 2.0f, h = 2.0f;
+    float depth = 0.0f;       // 0..1, orders draws with otherwise equal keys
+    unsigned int layer = 0;   // 0..63, higher layers are always drawn after lower ones
+    bool translucent = false;
+};
+
+struct RenderQueueStats
+{
+    unsigned int draws;
+    unsigned int programChanges;
+    unsigned int vertexArrayChanges;
+    unsigned int textureChanges;
+    size_t constantBytes; // per-draw constants written to the uniformRing
+};
+
+/*
+Collects draws for a frame, sorts them by a 64-bit key and issues them with as few state changes as possible.
+
+Key layout, most significant bits first:
+    layer (6) | overlap sub-layer (10) | translucent (1) | program (10) | VAO (10) | texture (10) | depth (17)
+
+The overlap sub-layer is what keeps painter's order intact: a draw gets a sub-layer one above every earlier draw
+it overlaps, so it can never be sorted in front of them. Draws that don't overlap anything end up in the same
+sub-layer and are free to be grouped by program, VAO and texture.
+*/
+class RenderQueue
+{
+public:
+    void clear();
+    // Commands without a program or pipeline, e.g. one shaderPipeline is still building, are dropped.
+    void submit(const DrawCommand& command);
+    /*
+    The same with a block of per-draw constants, the std140 contents of the program's "DrawConstants" block.
+    They are copied here; flush() writes the constants of all draws into the uniformRing at once and binds
+    each draw's slice to DRAW_CONSTANTS_BINDING, instead of setting uniforms before every draw.
+    */
+    void submit(const DrawCommand& command, const void* constants, size_t size);
+    // Sorts and issues every submitted draw through glState, then clears the queue.
+    void flush();
+
+    const RenderQueueStats& lastFlush() const { return stats; }
+
+private:
+    // Earlier draws touching one cell of the overlap grid. Only the CELL_DRAWS with the highest sub-layers are
+    // kept; the rest only leave the sub-layer every later draw touching the cell has to be above.
+    struct OverlapCell
+    {
+        std::vector<unsigned int> draws;
+        unsigned int minSubLayer = 0;
+    };
+    // Where a command's constants are in constantData, size 0 for none.
+    struct ConstantRange
+    {
+        size_t offset;
+        size_t size;
+    };
+
+    uint64_t makeKey(const DrawCommand& command, unsigned int subLayer) const;
+    void uploadConstants();
+    unsigned int overlapSubLayer(unsigned int commandIndex);
+    void radixSort();
+
+    std::vector<DrawCommand> commands;
+    std::vector<unsigned int> subLayers;
+    std::vector<ConstantRange> constantRanges;
+    std::vector<unsigned char> constantData;
+    std::vector<UniformSlice> constantSlices; // by command, filled in by flush()
+    std::vector<uint64_t> keys;
+    std::vector<unsigned int> order, scratchOrder;
+    std::vector<uint64_t> scratchKeys;
+    // commands touching each cell of a 16x16 grid over the screen, to find overlaps quickly
+    OverlapCell cells[16 * 16];
+    bool subLayerOverflow = false;
+    RenderQueueStats stats = { 0, 0, 0, 0, 0 };
+};
@@ -0,0 +1,90 @@
+#include "Shader.h"
+#include "GLExtensions.h"
+#include "ProgramCache.h"
+#include "Profiler.h"
+#include <chrono>
+#include <iostream>
+
+unsigned int compileShader(GLenum type, const char* source, const char* name)
+{
+    PROFILE_ZONE("compileShader");
+    unsigned int shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    // check for shader compile errors
+    int success;
+    char infoLog[512];
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::" << name << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+unsigned int linkProgram(unsigned int vertexShader, unsigned int fragmentShader)
+{
+    PROFILE_ZONE("linkProgram");
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    programCache.prepareLink(program);
+    glLinkProgram(program);
+    int success;
+    char infoLog[512];
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    // The program keeps its own copy of the compiled code.
+    glDetachShader(program, vertexShader);
+    glDetachShader(program, fragmentShader);
+    return program;
+}
+
+unsigned int linkSeparableProgram(unsigned int shader)
+{
+    PROFILE_ZONE("linkSeparableProgram");
+    unsigned int program = glCreateProgram();
+    glExt.programParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    glAttachShader(program, shader);
+    programCache.prepareLink(program);
+    glLinkProgram(program);
+    int success;
+    char infoLog[512];
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    glDetachShader(program, shader);
+    return program;
+}
+
+unsigned int createProgram(const char* vertexSource, const char* fragmentSource)
+{
+    // a binary saved by an earlier run skips compiling and linking altogether
+    unsigned int program = programCache.load(vertexSource, fragmentSource);
+    if (program)
+        return program;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource, "VERTEX");
+    unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource, "FRAGMENT");
+    if (vertexShader && fragmentShader)
+        program = linkProgram(vertexShader, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    if (program)
+        programCache.store(program, vertexSource, fragmentSource,
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return program;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Compiles a single shader stage. The name is only used in the error message,
+// e.g. "VERTEX" or "FRAGMENT". Returns 0 if compilation failed.
+unsigned int compileShader(GLenum type, const char* source, const char* name);
+
+// Links a vertex and fragment shader into a program. Returns 0 if linking failed.
+// The shaders are not deleted, so one vertex shader can be linked into several programs.
+unsigned int linkProgram(unsigned int vertexShader, unsigned int fragmentShader);
+
+// Links a single shader into a separable program for a program pipeline (glExt.separateShaderObjects).
+// Returns 0 if linking failed. The shader is not deleted.
+unsigned int linkSeparableProgram(unsigned int shader);
+
+// Convenience wrapper: compile both stages, link them and delete the shader objects.
+// Goes through programCache, so with the cache on a program built before is loaded from disk instead.
+unsigned int createProgram(const char* vertexSource, const char* fragmentSource);
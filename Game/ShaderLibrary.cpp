@@ -0,0 +1,338 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "Profiler.h"
+#include "Shader.h"
+#include "ShaderLibrary.h"
+#include "ShaderPipeline.h"
+
+ShaderLibrary shaderLibrary;
+
+typedef std::chrono::steady_clock Clock;
+
+static bool readFile(const std::string& path, std::string& text)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    text.clear();
+    char buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        text.append(buffer, count);
+    fclose(file);
+    return true;
+}
+
+static bool writeFile(const std::string& path, const char* text)
+{
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        std::cout << "ERROR::SHADER_LIBRARY::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+    fputs(text, file);
+    fclose(file);
+    return true;
+}
+
+// Modification time, 0 if the file doesn't exist.
+static long long modificationTime(const std::string& path)
+{
+#ifdef _WIN32
+    struct _stat64 info;
+    return _stat64(path.c_str(), &info) == 0 ? (long long)info.st_mtime : 0;
+#else
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 ? (long long)info.st_mtime : 0;
+#endif
+}
+
+bool ShaderLibrary::watch(const char* watchDirectory, const ShaderWorkerHooks& hooks)
+{
+    stop();
+#ifdef _WIN32
+    int made = _mkdir(watchDirectory);
+#else
+    int made = mkdir(watchDirectory, 0755);
+#endif
+    if (made != 0 && errno != EEXIST)
+    {
+        std::cout << "ERROR::SHADER_LIBRARY::CANNOT_CREATE_DIRECTORY " << watchDirectory << std::endl;
+        return false;
+    }
+    directory = watchDirectory;
+#ifdef __linux__
+    watchHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // editors either write the file in place or write a new one and rename it over the old one
+    if (watchHandle >= 0 && inotify_add_watch(watchHandle, watchDirectory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        close(watchHandle);
+        watchHandle = -1;
+    }
+#endif
+    watching = true;
+    running = true;
+    worker = std::thread(&ShaderLibrary::run, this, hooks);
+    return true;
+}
+
+void ShaderLibrary::stop()
+{
+    if (worker.joinable())
+    {
+        running = false;
+        worker.join();
+    }
+#ifdef __linux__
+    if (watchHandle >= 0)
+        close(watchHandle);
+#endif
+    watchHandle = -1;
+    watching = false;
+    // rebuilt programs nobody picked up
+    for (Rebuilt& rebuilt : finished)
+        for (unsigned int program : rebuilt.programs)
+            glDeleteProgram(program);
+    finished.clear();
+    entries.clear();
+}
+
+std::string ShaderLibrary::path(const ShaderTemplate& shaderTemplate, const char* extension) const
+{
+    return directory + "/" + shaderTemplate.fileName + extension;
+}
+
+ShaderLibrary::Entry& ShaderLibrary::entry(const ShaderTemplate& shaderTemplate)
+{
+    for (Entry& existing : entries)
+        if (existing.shaderTemplate == &shaderTemplate)
+            return existing;
+
+    // first use: read the files, or start them off with the built-in sources
+    entries.emplace_back();
+    Entry& added = entries.back();
+    added.shaderTemplate = &shaderTemplate;
+    std::string vertexPath = path(shaderTemplate, ".vert");
+    std::string fragmentPath = path(shaderTemplate, ".frag");
+    if (!readFile(vertexPath, added.sources.vertex))
+    {
+        added.sources.vertex = shaderTemplate.vertexSource;
+        writeFile(vertexPath, shaderTemplate.vertexSource);
+    }
+    if (!readFile(fragmentPath, added.sources.fragment))
+    {
+        added.sources.fragment = shaderTemplate.fragmentSource;
+        writeFile(fragmentPath, shaderTemplate.fragmentSource);
+    }
+    added.modified = std::max(modificationTime(vertexPath), modificationTime(fragmentPath));
+    return added;
+}
+
+ShaderSources ShaderLibrary::sources(const ShaderTemplate& shaderTemplate)
+{
+    if (!watching)
+        return ShaderSources{ shaderTemplate.vertexSource, shaderTemplate.fragmentSource };
+    std::lock_guard<std::mutex> lock(mutex);
+    return entry(shaderTemplate).sources;
+}
+
+void ShaderLibrary::addVariant(const ShaderTemplate& shaderTemplate, GLenum stage, unsigned int features, unsigned int job)
+{
+    if (!watching)
+        return;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Variant>& variants = entry(shaderTemplate).variants;
+    for (const Variant& variant : variants)
+        if (variant.stage == stage && variant.features == features)
+            return;
+    variants.push_back({ stage, features, job });
+}
+
+ShaderSources ShaderLibrary::specialize(const ShaderSources& sources, const Variant& variant)
+{
+    ShaderSources result;
+    if (variant.stage == 0)
+    {
+        result.vertex = ShaderVariants::specialize(sources.vertex.c_str(), variant.features);
+        result.fragment = ShaderVariants::specialize(sources.fragment.c_str(), variant.features);
+    }
+    else if (variant.stage == GL_VERTEX_SHADER)
+        result.vertex = ShaderVariants::specializeStage(sources.vertex.c_str(), variant.features, GL_VERTEX_SHADER);
+    else
+        result.fragment = ShaderVariants::specializeStage(sources.fragment.c_str(), variant.features, GL_FRAGMENT_SHADER);
+    return result;
+}
+
+bool ShaderLibrary::update()
+{
+    std::vector<Rebuilt> done;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.swap(finished);
+    }
+    for (Rebuilt& rebuilt : done)
+    {
+        for (size_t i = 0; i < rebuilt.variants.size(); i++)
+        {
+            ShaderSources specialized = specialize(rebuilt.sources, rebuilt.variants[i]);
+            shaderPipeline.replace(rebuilt.variants[i].job, rebuilt.programs[i], specialized.vertex, specialized.fragment,
+                rebuilt.buildMs / rebuilt.variants.size());
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            entry(*rebuilt.shaderTemplate).sources = rebuilt.sources;
+        }
+        printf("Reloaded %s, %u programs in %.2f ms\n", rebuilt.shaderTemplate->name, (unsigned int)rebuilt.variants.size(), rebuilt.buildMs);
+    }
+    return !done.empty();
+}
+
+void ShaderLibrary::run(ShaderWorkerHooks hooks)
+{
+    if (profiler.isEnabled())
+        profiler.setThreadName("shader reload");
+    if (!hooks.makeCurrent())
+    {
+        std::cout << "ERROR::SHADER_LIBRARY::NO_WORKER_CONTEXT" << std::endl;
+        return;
+    }
+    std::vector<std::string> changed;
+    std::vector<const ShaderTemplate*> templates;
+    while (running)
+    {
+        changed.clear();
+        waitForChanges(changed);
+        templates.clear();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const Entry& entry : entries)
+                for (const std::string& name : changed)
+                    if (name == std::string(entry.shaderTemplate->fileName) + ".vert" || name == std::string(entry.shaderTemplate->fileName) + ".frag")
+                    {
+                        templates.push_back(entry.shaderTemplate);
+                        break;
+                    }
+        }
+        bool anyFinished = false;
+        for (const ShaderTemplate* shaderTemplate : templates)
+            anyFinished |= rebuild(*shaderTemplate);
+        if (anyFinished && hooks.wake)
+            hooks.wake();
+    }
+    hooks.doneCurrent();
+}
+
+void ShaderLibrary::waitForChanges(std::vector<std::string>& changed)
+{
+#ifdef __linux__
+    if (watchHandle >= 0)
+    {
+        pollfd descriptor = { watchHandle, POLLIN, 0 };
+        if (poll(&descriptor, 1, 250) <= 0)
+            return;
+        // a save often comes as several events in a row, collect them all before rebuilding anything
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = read(watchHandle, buffer, sizeof(buffer))) > 0)
+            for (char* at = buffer; at < buffer + length; )
+            {
+                const inotify_event* event = (const inotify_event*)at;
+                if (event->len)
+                    changed.push_back(event->name);
+                at += sizeof(inotify_event) + event->len;
+            }
+        return;
+    }
+#endif
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Entry& entry : entries)
+    {
+        long long modified = std::max(modificationTime(path(*entry.shaderTemplate, ".vert")),
+            modificationTime(path(*entry.shaderTemplate, ".frag")));
+        if (modified > entry.modified)
+        {
+            entry.modified = modified;
+            changed.push_back(std::string(entry.shaderTemplate->fileName) + ".vert");
+        }
+    }
+}
+
+bool ShaderLibrary::rebuild(const ShaderTemplate& shaderTemplate)
+{
+    PROFILE_ZONE("ShaderLibrary::rebuild");
+    Clock::time_point start = Clock::now();
+    Rebuilt rebuilt;
+    rebuilt.shaderTemplate = &shaderTemplate;
+    if (!readFile(path(shaderTemplate, ".vert"), rebuilt.sources.vertex) || !readFile(path(shaderTemplate, ".frag"), rebuilt.sources.fragment))
+        return false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const Entry& current = entry(shaderTemplate);
+        // saved without changes
+        if (current.sources.vertex == rebuilt.sources.vertex && current.sources.fragment == rebuilt.sources.fragment)
+            return false;
+        // separate stage programs only need rebuilding if their own file changed
+        for (const Variant& variant : current.variants)
+            if (!(variant.stage == GL_VERTEX_SHADER && current.sources.vertex == rebuilt.sources.vertex)
+                && !(variant.stage == GL_FRAGMENT_SHADER && current.sources.fragment == rebuilt.sources.fragment))
+                rebuilt.variants.push_back(variant);
+    }
+
+    // compileShader and linkProgram print what went wrong
+    for (const Variant& variant : rebuilt.variants)
+    {
+        ShaderSources specialized = specialize(rebuilt.sources, variant);
+        unsigned int program = 0;
+        if (variant.stage == 0)
+        {
+            unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, specialized.vertex.c_str(), "VERTEX");
+            unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, specialized.fragment.c_str(), "FRAGMENT");
+            program = vertexShader && fragmentShader ? linkProgram(vertexShader, fragmentShader) : 0;
+            glDeleteShader(vertexShader);
+            glDeleteShader(fragmentShader);
+        }
+        else
+        {
+            bool vertex = variant.stage == GL_VERTEX_SHADER;
+            unsigned int shader = compileShader(variant.stage, vertex ? specialized.vertex.c_str() : specialized.fragment.c_str(),
+                vertex ? "VERTEX" : "FRAGMENT");
+            program = shader ? linkSeparableProgram(shader) : 0;
+            glDeleteShader(shader);
+        }
+        if (!program)
+        {
+            std::cout << "ERROR::SHADER_LIBRARY::RELOAD_FAILED " << shaderTemplate.name << ", keeping the old programs" << std::endl;
+            for (unsigned int built : rebuilt.programs)
+                glDeleteProgram(built);
+            return false;
+        }
+        rebuilt.programs.push_back(program);
+    }
+
+    // Objects changed in one context may only be used in another once the change is complete.
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 5000000000ull);
+    glDeleteSync(fence);
+
+    rebuilt.buildMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(mutex);
+    finished.push_back(std::move(rebuilt));
+    return true;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ShaderVariants.h"
+
+struct ShaderSources
+{
+    std::string vertex, fragment;
+};
+
+// How the worker thread gets a context of its own that shares objects with the one the frames are drawn with.
+struct ShaderWorkerHooks
+{
+    std::function<bool()> makeCurrent; // on the worker thread, before anything else
+    std::function<void()> doneCurrent; // on the worker thread, before it exits
+    std::function<void()> wake;        // from the worker thread once a rebuilt template is waiting in update()
+};
+
+/*
+Where the sources of the shader templates come from, and the hot reload.
+
+Normally the sources are the strings compiled into the program. After watch(DIR) every template is read from
+DIR/fileName.vert and DIR/fileName.frag instead; a file that doesn't exist yet is written with the built-in
+source, so there is something to edit.
+
+A worker thread waits for the files to change (inotify on Linux, checking modification times elsewhere),
+then compiles and links every variant of the template that is in use, with its own GL context in the same
+share group. Variants built as separate stage programs are only rebuilt for the stage whose file changed. The render loop never waits for it: update() picks up finished templates between frames and
+swaps all their variants at once through shaderPipeline.replace(). If any variant fails to build, the errors
+are printed and the old programs stay.
+*/
+class ShaderLibrary
+{
+public:
+    ~ShaderLibrary() { stop(); }
+
+    bool watch(const char* directory, const ShaderWorkerHooks& hooks);
+    void stop();
+    bool isWatching() const { return watching; }
+
+    // The template's current sources.
+    ShaderSources sources(const ShaderTemplate& shaderTemplate);
+    // Remembers a variant built from sources(), so it is rebuilt when the files change. Only while watching.
+    // stage is 0 for a whole program, or the one stage of a separable program.
+    void addVariant(const ShaderTemplate& shaderTemplate, GLenum stage, unsigned int features, unsigned int job);
+
+    // Swaps in every template the worker finished rebuilding. Returns true if a program changed,
+    // anything drawn with the old ones should be drawn again.
+    bool update();
+
+private:
+    struct Variant
+    {
+        GLenum stage;
+        unsigned int features;
+        unsigned int job; // shaderPipeline job
+    };
+    struct Entry
+    {
+        const ShaderTemplate* shaderTemplate;
+        ShaderSources sources; // what the variants in use were built from
+        std::vector<Variant> variants;
+        long long modified = 0; // newest modification time of the two files, when polling
+    };
+    struct Rebuilt
+    {
+        const ShaderTemplate* shaderTemplate;
+        ShaderSources sources;
+        std::vector<Variant> variants;
+        std::vector<unsigned int> programs; // by variant
+        double buildMs;
+    };
+
+    Entry& entry(const ShaderTemplate& shaderTemplate);
+    std::string path(const ShaderTemplate& shaderTemplate, const char* extension) const;
+
+    void run(ShaderWorkerHooks hooks);
+    // Names of the files in the directory that changed, waiting up to about a quarter of a second.
+    void waitForChanges(std::vector<std::string>& changed);
+    // The specialized sources of a variant, one of them empty for a separable stage.
+    static ShaderSources specialize(const ShaderSources& sources, const Variant& variant);
+    // Builds every variant in use from the files. True if the result is waiting for update().
+    bool rebuild(const ShaderTemplate& shaderTemplate);
+
+    std::string directory;
+    bool watching = false;
+    std::atomic<bool> running{ false };
+    std::thread worker;
+    int watchHandle = -1; // inotify descriptor
+
+    // entries and finished are shared with the worker
+    std::mutex mutex;
+    std::vector<Entry> entries;
+    std::vector<Rebuilt> finished;
+};
+
+extern ShaderLibrary shaderLibrary;
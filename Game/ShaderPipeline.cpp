@@ -0,0 +1,246 @@
+#include <glad/glad.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "Profiler.h"
+#include "ProgramCache.h"
+#include "ShaderPipeline.h"
+
+ShaderPipeline shaderPipeline;
+
+static double nowMs()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ShaderPipeline::init()
+{
+    // let the driver decide how many threads its compiler uses
+    if (glExt.parallelShaderCompile)
+        glExt.maxShaderCompilerThreads(0xFFFFFFFFu);
+}
+
+void ShaderPipeline::destroy()
+{
+    for (Job& job : jobs)
+    {
+        glDeleteShader(job.vertexShader);
+        glDeleteShader(job.fragmentShader);
+        glState.deleteProgram(job.program);
+    }
+    jobs.clear();
+    pending = failed = 0;
+}
+
+unsigned int ShaderPipeline::request(const char* name, const char* vertexSource, const char* fragmentSource, ReadyCallback onReady)
+{
+    return add(name, vertexSource, fragmentSource, false, onReady);
+}
+
+unsigned int ShaderPipeline::requestStage(const char* name, GLenum stage, const char* source, ReadyCallback onReady)
+{
+    if (stage == GL_VERTEX_SHADER)
+        return add(name, source, "", true, onReady);
+    return add(name, "", source, true, onReady);
+}
+
+unsigned int ShaderPipeline::add(const char* name, const char* vertexSource, const char* fragmentSource, bool separable, ReadyCallback onReady)
+{
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        Job& job = jobs[i];
+        if (job.separable != separable || job.vertexSource != vertexSource || job.fragmentSource != fragmentSource)
+            continue;
+        if (!onReady)
+            return (unsigned int)i + 1;
+        if (job.state == JOB_READY)
+            onReady(job.program);
+        job.onReady.push_back(onReady);
+        return (unsigned int)i + 1;
+    }
+
+    PROFILE_ZONE("ShaderPipeline::request");
+    jobs.emplace_back();
+    Job& job = jobs.back();
+    job.name = name;
+    job.vertexSource = vertexSource;
+    job.fragmentSource = fragmentSource;
+    job.separable = separable;
+    unsigned int id = (unsigned int)jobs.size();
+
+    job.program = programCache.load(vertexSource, fragmentSource, separable);
+    if (onReady)
+        job.onReady.push_back(onReady);
+    if (job.program)
+    {
+        job.state = JOB_READY;
+        if (onReady)
+            onReady(job.program);
+        return id;
+    }
+    job.requestedNs = profiler.isEnabled() ? profiler.now() : 0;
+    job.requestedMs = nowMs();
+
+    // No status queries in here, they would wait for the compiler. A failed compile shows up as a failed link.
+    if (*vertexSource)
+    {
+        job.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(job.vertexShader, 1, &vertexSource, NULL);
+        glCompileShader(job.vertexShader);
+    }
+    if (*fragmentSource)
+    {
+        job.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(job.fragmentShader, 1, &fragmentSource, NULL);
+        glCompileShader(job.fragmentShader);
+    }
+
+    job.program = glCreateProgram();
+    if (separable)
+        glExt.programParameteri(job.program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    if (job.vertexShader)
+        glAttachShader(job.program, job.vertexShader);
+    if (job.fragmentShader)
+        glAttachShader(job.program, job.fragmentShader);
+    programCache.prepareLink(job.program);
+    glLinkProgram(job.program);
+    pending++;
+    return id;
+}
+
+bool ShaderPipeline::poll()
+{
+    bool anyReady = false;
+    for (Job& job : jobs)
+    {
+        if (job.state != JOB_BUILDING)
+            continue;
+        if (glExt.parallelShaderCompile)
+        {
+            int done = 0;
+            glGetProgramiv(job.program, GL_COMPLETION_STATUS_KHR, &done);
+            if (!done)
+                continue;
+        }
+        complete(job);
+        anyReady |= job.state == JOB_READY;
+    }
+    return anyReady;
+}
+
+void ShaderPipeline::finish()
+{
+    PROFILE_ZONE("ShaderPipeline::finish");
+    for (Job& job : jobs)
+        if (job.state == JOB_BUILDING)
+            complete(job);
+}
+
+void ShaderPipeline::complete(Job& job)
+{
+    PROFILE_ZONE("ShaderPipeline::complete");
+    pending--;
+    int success;
+    char infoLog[512];
+    glGetProgramiv(job.program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        // same messages as compileShader() and linkProgram()
+        unsigned int shaders[2] = { job.vertexShader, job.fragmentShader };
+        const char* stages[2] = { "VERTEX", "FRAGMENT" };
+        bool compiled = true;
+        for (int i = 0; i < 2; i++)
+        {
+            if (!shaders[i])
+                continue;
+            glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
+            if (!success)
+            {
+                glGetShaderInfoLog(shaders[i], 512, NULL, infoLog);
+                std::cout << "ERROR::SHADER::" << stages[i] << "::COMPILATION_FAILED (" << job.name << ")\n" << infoLog << std::endl;
+                compiled = false;
+            }
+        }
+        if (compiled)
+        {
+            glGetProgramInfoLog(job.program, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED (" << job.name << ")\n" << infoLog << std::endl;
+        }
+        glDeleteProgram(job.program);
+        job.program = 0;
+        job.state = JOB_FAILED;
+        failed++;
+    }
+    else
+    {
+        if (job.vertexShader)
+            glDetachShader(job.program, job.vertexShader);
+        if (job.fragmentShader)
+            glDetachShader(job.program, job.fragmentShader);
+        job.state = JOB_READY;
+        programCache.store(job.program, job.vertexSource.c_str(), job.fragmentSource.c_str(), nowMs() - job.requestedMs);
+        for (ReadyCallback& onReady : job.onReady)
+            onReady(job.program);
+    }
+    glDeleteShader(job.vertexShader);
+    glDeleteShader(job.fragmentShader);
+    job.vertexShader = job.fragmentShader = 0;
+
+    // The compile ran inside the driver, so it gets a row of its own in the trace.
+    // It ends when poll() noticed it was done, not necessarily when the driver finished.
+    if (profiler.isEnabled())
+    {
+        uint64_t end = profiler.now();
+        profiler.recordLane(compileLane(job.name, job.requestedNs, end), "compile + link", job.requestedNs, end);
+    }
+}
+
+unsigned int ShaderPipeline::compileLane(const char* name, uint64_t begin, uint64_t end)
+{
+    for (CompileLane& lane : lanes)
+    {
+        if (lane.endNs <= begin && strcmp(lane.name, name) == 0)
+        {
+            lane.endNs = end;
+            return lane.lane;
+        }
+    }
+    lanes.push_back({ name, profiler.addLane(name), end });
+    return lanes.back().lane;
+}
+
+void ShaderPipeline::replace(unsigned int id, unsigned int program, const std::string& vertexSource, const std::string& fragmentSource, double buildMs)
+{
+    Job& job = jobs[id - 1];
+    if (job.state == JOB_BUILDING)
+    {
+        // the newer sources win, the build still in flight is dropped
+        glDeleteShader(job.vertexShader);
+        glDeleteShader(job.fragmentShader);
+        job.vertexShader = job.fragmentShader = 0;
+        pending--;
+    }
+    else if (job.state == JOB_FAILED)
+        failed--;
+    glState.deleteProgram(job.program);
+    // the old sources are gone from disk, their blob would only pile up in the cache directory
+    programCache.remove(job.vertexSource.c_str(), job.fragmentSource.c_str());
+
+    job.program = program;
+    job.vertexSource = vertexSource;
+    job.fragmentSource = fragmentSource;
+    job.state = JOB_READY;
+    programCache.store(program, vertexSource.c_str(), fragmentSource.c_str(), buildMs);
+    for (ReadyCallback& onReady : job.onReady)
+        onReady(program);
+}
+
+unsigned int ShaderPipeline::program(unsigned int job) const
+{
+    if (job == 0 || job > jobs.size() || jobs[job - 1].state != JOB_READY)
+        return 0;
+    return jobs[job - 1].program;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+Builds programs without making the render loop wait for the shader compiler.
+
+request() hands both stages to the driver and links them right away, without asking for the compile
+status in between: asking after every glCompileShader is what makes drivers compile one shader after the
+other. With KHR_parallel_shader_compile the driver compiles on its own threads and poll() asks
+GL_COMPLETION_STATUS_KHR, which never blocks. Without it every compile and link has still been issued
+before the first status query, so drivers with a threaded compiler overlap them anyway, but the first
+poll() waits for the programs it looks at.
+
+Programs from the program cache are ready at once. The pipeline owns every program it built; asking for the
+same sources again returns the same job.
+*/
+class ShaderPipeline
+{
+public:
+    // Called with the new program once it linked, e.g. to look up uniforms, and again for every program that
+    // replace() puts in its place. Runs before program() returns it.
+    typedef std::function<void(unsigned int program)> ReadyCallback;
+
+    void init();
+    // Deletes every program.
+    void destroy();
+
+    // Starts building a program and returns its job id. name is shown in errors and the profiler and
+    // must be a string literal.
+    unsigned int request(const char* name, const char* vertexSource, const char* fragmentSource, ReadyCallback onReady = nullptr);
+    // The same for a separable program of just one stage, GL_VERTEX_SHADER or GL_FRAGMENT_SHADER, to be combined
+    // with others in a program pipeline. Needs glExt.separateShaderObjects.
+    unsigned int requestStage(const char* name, GLenum stage, const char* source, ReadyCallback onReady = nullptr);
+    // Finishes every job the driver is done with. Returns true if at least one program became ready.
+    bool poll();
+    // Waits for every job.
+    void finish();
+    // Puts a program linked elsewhere from new sources in place of the job's program, e.g. one the shader hot
+    // reload built. The old program is deleted. Call between frames, from the thread that draws.
+    void replace(unsigned int job, unsigned int program, const std::string& vertexSource, const std::string& fragmentSource, double buildMs);
+
+    // The linked program, 0 while it is still being built or if it failed.
+    unsigned int program(unsigned int job) const;
+    unsigned int pendingCount() const { return pending; }
+    unsigned int failedCount() const { return failed; }
+
+private:
+    enum JobState
+    {
+        JOB_BUILDING,
+        JOB_READY,
+        JOB_FAILED
+    };
+    struct Job
+    {
+        const char* name;
+        std::string vertexSource, fragmentSource; // one of them empty for a separable stage
+        bool separable = false;
+        unsigned int vertexShader = 0, fragmentShader = 0, program = 0;
+        JobState state = JOB_BUILDING;
+        std::vector<ReadyCallback> onReady;
+        uint64_t requestedNs = 0; // profiler time of the request
+        double requestedMs = 0.0; // for the program cache's build time
+    };
+
+    // A profiler lane for the compiles of one shader, and when the last zone recorded into it ended.
+    struct CompileLane
+    {
+        const char* name;
+        unsigned int lane;
+        uint64_t endNs;
+    };
+
+    unsigned int add(const char* name, const char* vertexSource, const char* fragmentSource, bool separable, ReadyCallback onReady);
+    // Checks a job the driver reports as done, whether it built.
+    void complete(Job& job);
+    // A lane for a compile from begin to end. Compiles of the same name share lanes; a new one is only added
+    // while every lane of that name is still busy, so the zones of a lane never overlap.
+    unsigned int compileLane(const char* name, uint64_t begin, uint64_t end);
+
+    std::vector<Job> jobs;
+    std::vector<CompileLane> lanes; // kept by destroy(), the profiler keeps them too
+    unsigned int pending = 0;
+    unsigned int failed = 0;
+};
+
+extern ShaderPipeline shaderPipeline;
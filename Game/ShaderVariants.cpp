@@ -0,0 +1,145 @@
+#include "ShaderVariants.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "ShaderLibrary.h"
+#include "ShaderPipeline.h"
+#include <cstring>
+
+const char* const shaderFeatureDefines[SHADER_FEATURE_COUNT] = {
+    "FEATURE_TEXTURE", "FEATURE_ROUNDED", "FEATURE_GRADIENT", "FEATURE_CLIP"
+};
+
+static_assert(shaderVariantId(SHADER_ROUNDED | SHADER_CLIP, SHADER_CLIP) == 2, "features are packed in bit order");
+static_assert(shaderVariantCount(SHADER_TEXTURE | SHADER_GRADIENT | SHADER_CLIP) == 8, "one variant per feature combination");
+
+void ShaderVariants::request(unsigned int variant)
+{
+    if (variant >= shaderVariantCount(shaderTemplate->features))
+        return;
+    if (variants.empty())
+    {
+        variants.resize(shaderVariantCount(shaderTemplate->features));
+        separate = shaderTemplate->separable && glExt.separateShaderObjects;
+    }
+    Variant& requested = variants[variant];
+    if (requested.job)
+        return;
+    unsigned int featureSet = features(variant);
+    ShaderSources sources = shaderLibrary.sources(*shaderTemplate);
+    // the pipeline keeps its own copies of the sources
+    if (!separate)
+    {
+        std::string vertex = specialize(sources.vertex.c_str(), featureSet);
+        std::string fragment = specialize(sources.fragment.c_str(), featureSet);
+        requested.job = shaderPipeline.request(shaderTemplate->name, vertex.c_str(), fragment.c_str(), shaderTemplate->onReady);
+        shaderLibrary.addVariant(*shaderTemplate, 0, featureSet, requested.job);
+        return;
+    }
+
+    // the same stage sources come back as the same job, so a vertex stage another variant uses isn't built again
+    unsigned int vertexFeatures = featureSet & shaderTemplate->vertexFeatures;
+    unsigned int fragmentFeatures = featureSet & ~shaderTemplate->vertexFeatures;
+    std::string vertex = specializeStage(sources.vertex.c_str(), vertexFeatures, GL_VERTEX_SHADER);
+    std::string fragment = specializeStage(sources.fragment.c_str(), fragmentFeatures, GL_FRAGMENT_SHADER);
+    requested.job = shaderPipeline.requestStage(shaderTemplate->name, GL_VERTEX_SHADER, vertex.c_str(), shaderTemplate->onReady);
+    requested.fragmentJob = shaderPipeline.requestStage(shaderTemplate->name, GL_FRAGMENT_SHADER, fragment.c_str(), shaderTemplate->onReady);
+    shaderLibrary.addVariant(*shaderTemplate, GL_VERTEX_SHADER, vertexFeatures, requested.job);
+    shaderLibrary.addVariant(*shaderTemplate, GL_FRAGMENT_SHADER, fragmentFeatures, requested.fragmentJob);
+}
+
+unsigned int ShaderVariants::program(unsigned int variant) const
+{
+    if (separate || variant >= variants.size())
+        return 0;
+    return shaderPipeline.program(variants[variant].job);
+}
+
+unsigned int ShaderVariants::pipeline(unsigned int variant) const
+{
+    if (!separate || variant >= variants.size())
+        return 0;
+    Variant& found = variants[variant];
+    unsigned int vertexProgram = shaderPipeline.program(found.job);
+    unsigned int fragmentProgram = shaderPipeline.program(found.fragmentJob);
+    if (!vertexProgram || !fragmentProgram)
+        return 0;
+    if (!found.pipeline)
+        glExt.genProgramPipelines(1, &found.pipeline);
+    if (found.vertexProgram != vertexProgram)
+    {
+        glExt.useProgramStages(found.pipeline, GL_VERTEX_SHADER_BIT, vertexProgram);
+        found.vertexProgram = vertexProgram;
+    }
+    if (found.fragmentProgram != fragmentProgram)
+    {
+        glExt.useProgramStages(found.pipeline, GL_FRAGMENT_SHADER_BIT, fragmentProgram);
+        found.fragmentProgram = fragmentProgram;
+    }
+    return found.pipeline;
+}
+
+bool ShaderVariants::bind(unsigned int variant) const
+{
+    if (separate)
+    {
+        unsigned int found = pipeline(variant);
+        if (found)
+            glState.bindProgramPipeline(found);
+        return found != 0;
+    }
+    unsigned int found = program(variant);
+    if (found)
+        glState.useProgram(found);
+    return found != 0;
+}
+
+void ShaderVariants::reset()
+{
+    for (const Variant& variant : variants)
+        if (variant.pipeline)
+            glState.deleteProgramPipeline(variant.pipeline);
+    variants.clear();
+    separate = false;
+}
+
+unsigned int ShaderVariants::features(unsigned int variant) const
+{
+    unsigned int result = 0, bit = 0;
+    for (unsigned int feature = 1; feature < (1u << SHADER_FEATURE_COUNT); feature <<= 1)
+        if (shaderTemplate->features & feature)
+        {
+            if (variant & (1u << bit))
+                result |= feature;
+            bit++;
+        }
+    return result;
+}
+
+// text inserted after the #version line, which has to stay the first one
+static std::string afterVersion(const char* source, const std::string& text)
+{
+    std::string result = source;
+    size_t lineEnd = strncmp(source, "#version", 8) == 0 ? result.find('\n') : std::string::npos;
+    size_t insertAt = lineEnd == std::string::npos ? 0 : lineEnd + 1;
+    result.insert(insertAt, text);
+    return result;
+}
+
+std::string ShaderVariants::specialize(const char* source, unsigned int features)
+{
+    std::string defines;
+    for (int i = 0; i < SHADER_FEATURE_COUNT; i++)
+        if (features & (1u << i))
+            defines += std::string("#define ") + shaderFeatureDefines[i] + "\n";
+    return afterVersion(source, defines);
+}
+
+std::string ShaderVariants::specializeStage(const char* source, unsigned int features, GLenum stage)
+{
+    // GLSL 3.30 only knows separable programs through the extension, and it wants the built-in outputs of a
+    // separate vertex stage declared. The in and out variables still match up by name.
+    std::string header = "#extension GL_ARB_separate_shader_objects : enable\n";
+    if (stage == GL_VERTEX_SHADER)
+        header += "out gl_PerVertex { vec4 gl_Position; };\n";
+    return afterVersion(specialize(source, features).c_str(), header);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// Optional parts of a shader. Every template says which of them its sources know about.
+enum ShaderFeature
+{
+    SHADER_TEXTURE = 1 << 0,  // multiplies with the texture bound to unit 0
+    SHADER_ROUNDED = 1 << 1,  // rounded corners
+    SHADER_GRADIENT = 1 << 2, // vertical gradient
+    SHADER_CLIP = 1 << 3,     // clipping to a rectangle
+    SHADER_FEATURE_COUNT = 4
+};
+// The #define each feature turns on in the sources, in bit order.
+extern const char* const shaderFeatureDefines[SHADER_FEATURE_COUNT];
+
+/*
+Feature set to variant id, for a template supporting the features in supported.
+The supported bits are packed together, so the ids of a template run from 0 to shaderVariantCount() - 1
+and can index an array. Features the template doesn't support are ignored.
+Both are constexpr, so a fixed feature set is turned into its id by the compiler.
+*/
+constexpr unsigned int shaderVariantId(unsigned int supported, unsigned int features)
+{
+    unsigned int id = 0, bit = 0;
+    for (unsigned int feature = 1; feature < (1u << SHADER_FEATURE_COUNT); feature <<= 1)
+        if (supported & feature)
+        {
+            if (features & feature)
+                id |= 1u << bit;
+            bit++;
+        }
+    return id;
+}
+
+constexpr unsigned int shaderVariantCount(unsigned int supported)
+{
+    // every supported feature on is the highest id
+    return shaderVariantId(supported, supported) + 1;
+}
+
+// Sources with #ifdef FEATURE_... blocks, specialized per variant by inserting #defines after the #version line.
+struct ShaderTemplate
+{
+    const char* name;     // for errors and the profiler
+    const char* fileName; // fileName.vert and fileName.frag replace the sources while shaderLibrary watches a directory
+    const char* vertexSource;
+    const char* fragmentSource;
+    unsigned int features; // the ShaderFeatures the sources have blocks for
+    // The features that change the vertex shader. The others only change the fragment shader when the two are
+    // built as separate programs, so every fragment variant shares one vertex program.
+    unsigned int vertexFeatures;
+    // True if the stages may be built separately: the outputs of the vertex shader don't depend on features
+    // and uniforms are only set through uniform blocks or onReady, never on a program found with program().
+    bool separable;
+    void (*onReady)(unsigned int program); // called for every variant once it linked, may be null
+};
+
+/*
+The variants of one template that are in use. A variant is requested from shaderPipeline the first time
+it is asked for and goes through the program cache like any other program; after that looking it up is an
+array access by variant id, no strings involved.
+The sources come from shaderLibrary, which rebuilds every requested variant when the template's files change.
+
+With separate shader objects a separable template is built as one program per stage instead, and a variant
+is a program pipeline combining them. A vertex shader is then compiled and linked once for all the variants
+that only differ in fragment features, instead of being linked again into every program. Without them, or for
+templates that aren't separable, every variant is one program as before; bind() and the pair of program() and
+pipeline() work the same either way.
+*/
+class ShaderVariants
+{
+public:
+    explicit ShaderVariants(const ShaderTemplate& shaderTemplate) : shaderTemplate(&shaderTemplate) {}
+
+    // Starts building the variant unless that already happened.
+    void request(unsigned int variant);
+    // The variant's program, 0 if it wasn't requested, is still being built or is a program pipeline.
+    unsigned int program(unsigned int variant) const;
+    // The variant's program pipeline, 0 unless it is built from separate stage programs that are both ready.
+    unsigned int pipeline(unsigned int variant) const;
+    // Makes the variant current through glState. False if it isn't ready.
+    bool bind(unsigned int variant) const;
+    // Forgets every variant and deletes their program pipelines, e.g. after shaderPipeline.destroy().
+    void reset();
+
+    // The features of a variant id, the reverse of shaderVariantId().
+    unsigned int features(unsigned int variant) const;
+    // source with the #defines of the features added after its #version line.
+    static std::string specialize(const char* source, unsigned int features);
+    // The same for one stage of a separable template built on its own, GL_VERTEX_SHADER or GL_FRAGMENT_SHADER.
+    static std::string specializeStage(const char* source, unsigned int features, GLenum stage);
+
+private:
+    struct Variant
+    {
+        unsigned int job = 0;         // shaderPipeline job of the program, or of the vertex stage
+        unsigned int fragmentJob = 0; // of the fragment stage, when separate
+        // created once both stages are ready, and told about stages the hot reload replaced
+        unsigned int pipeline = 0;
+        unsigned int vertexProgram = 0, fragmentProgram = 0;
+    };
+
+    const ShaderTemplate* shaderTemplate;
+    bool separate = false;
+    mutable std::vector<Variant> variants; // by variant id, job 0 if not requested yet
+};
@@ -0,0 +1,442 @@
+#include "SoftwareRasterizer.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define RASTER_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC accepts intrinsics of any instruction set without special flags
+#define RASTER_TARGET_AVX2
+#define RASTER_TARGET_SSE2
+#else
+#define RASTER_TARGET_AVX2 __attribute__((target("avx2")))
+#define RASTER_TARGET_SSE2 __attribute__((target("sse2")))
+#endif
+#endif
+
+// Vertices are snapped to 1/16 pixel.
+const int SUBPIXEL_BITS = 4;
+const int SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+/*
+Vertices are clamped to this many pixels around the screen. That keeps every edge function inside a tile
+within 32 bits; triangles reaching further out than this are distorted, but there are none in the UI.
+*/
+const int GUARD_BAND = 16384;
+
+static float saturate(float v)
+{
+    return std::min(std::max(v, 0.0f), 1.0f);
+}
+
+static uint32_t shadePixel(const RasterBlock& block, int x, int y)
+{
+    float channels[4];
+    for (int c = 0; c < 4; c++)
+        channels[c] = saturate(block.plane[c][0] + (x + 0.5f) * block.plane[c][1] + (y + 0.5f) * block.plane[c][2]);
+    return packColor(channels[0], channels[1], channels[2], channels[3]);
+}
+
+static void fillScalar(const RasterBlock& block, uint32_t* pixels, int stride)
+{
+    int rowE[3] = { block.e[0], block.e[1], block.e[2] };
+    for (int row = 0; row < block.rows; row++)
+    {
+        int y = block.y0 + row;
+        uint32_t* dst = pixels + (size_t)y * stride + block.x0;
+        int e0 = rowE[0], e1 = rowE[1], e2 = rowE[2];
+        for (int i = 0; i < block.blocks * 8; i++)
+        {
+            if ((e0 | e1 | e2) >= 0)
+                dst[i] = block.flat ? block.color : shadePixel(block, block.x0 + i, y);
+            e0 += block.dx[0];
+            e1 += block.dx[1];
+            e2 += block.dx[2];
+        }
+        for (int k = 0; k < 3; k++)
+            rowE[k] += block.dy[k];
+    }
+}
+
+#ifdef RASTER_X86
+RASTER_TARGET_SSE2 static __m128i shadeSSE2(const RasterBlock& block, int x, int y)
+{
+    __m128 fx = _mm_add_ps(_mm_set1_ps(x + 0.5f), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+    __m128 fy = _mm_set1_ps(y + 0.5f);
+    __m128i result = _mm_setzero_si128();
+    for (int c = 0; c < 4; c++)
+    {
+        __m128 v = _mm_add_ps(_mm_set1_ps(block.plane[c][0]),
+            _mm_add_ps(_mm_mul_ps(fx, _mm_set1_ps(block.plane[c][1])), _mm_mul_ps(fy, _mm_set1_ps(block.plane[c][2]))));
+        v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        __m128i byte = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+        result = _mm_or_si128(result, _mm_slli_epi32(byte, c * 8));
+    }
+    return result;
+}
+
+// Eight pixels as two halves of four.
+RASTER_TARGET_SSE2 static void fillSSE2(const RasterBlock& block, uint32_t* pixels, int stride)
+{
+    __m128i stepLo[3], stepHi[3], blockStep[3], rowE[3];
+    for (int k = 0; k < 3; k++)
+    {
+        int d = block.dx[k];
+        stepLo[k] = _mm_setr_epi32(0, d, 2 * d, 3 * d);
+        stepHi[k] = _mm_setr_epi32(4 * d, 5 * d, 6 * d, 7 * d);
+        blockStep[k] = _mm_set1_epi32(8 * d);
+        rowE[k] = _mm_set1_epi32(block.e[k]);
+    }
+    const __m128i minusOne = _mm_set1_epi32(-1);
+    const __m128i flatColor = _mm_set1_epi32((int)block.color);
+
+    for (int row = 0; row < block.rows; row++)
+    {
+        int y = block.y0 + row;
+        uint32_t* dst = pixels + (size_t)y * stride + block.x0;
+        __m128i eLo[3], eHi[3];
+        for (int k = 0; k < 3; k++)
+        {
+            eLo[k] = _mm_add_epi32(rowE[k], stepLo[k]);
+            eHi[k] = _mm_add_epi32(rowE[k], stepHi[k]);
+        }
+        for (int b = 0; b < block.blocks; b++, dst += 8)
+        {
+            // a pixel is inside when no edge function is negative, i.e. the sign bit of their OR is clear
+            __m128i inLo = _mm_cmpgt_epi32(_mm_or_si128(_mm_or_si128(eLo[0], eLo[1]), eLo[2]), minusOne);
+            __m128i inHi = _mm_cmpgt_epi32(_mm_or_si128(_mm_or_si128(eHi[0], eHi[1]), eHi[2]), minusOne);
+            if (_mm_movemask_epi8(_mm_or_si128(inLo, inHi)))
+            {
+                int x = block.x0 + b * 8;
+                __m128i srcLo = block.flat ? flatColor : shadeSSE2(block, x, y);
+                __m128i srcHi = block.flat ? flatColor : shadeSSE2(block, x + 4, y);
+                __m128i oldLo = _mm_loadu_si128((const __m128i*)dst);
+                __m128i oldHi = _mm_loadu_si128((const __m128i*)(dst + 4));
+                _mm_storeu_si128((__m128i*)dst, _mm_or_si128(_mm_and_si128(inLo, srcLo), _mm_andnot_si128(inLo, oldLo)));
+                _mm_storeu_si128((__m128i*)(dst + 4), _mm_or_si128(_mm_and_si128(inHi, srcHi), _mm_andnot_si128(inHi, oldHi)));
+            }
+            for (int k = 0; k < 3; k++)
+            {
+                eLo[k] = _mm_add_epi32(eLo[k], blockStep[k]);
+                eHi[k] = _mm_add_epi32(eHi[k], blockStep[k]);
+            }
+        }
+        for (int k = 0; k < 3; k++)
+            rowE[k] = _mm_add_epi32(rowE[k], _mm_set1_epi32(block.dy[k]));
+    }
+}
+
+RASTER_TARGET_AVX2 static __m256i shadeAVX2(const RasterBlock& block, int x, int y)
+{
+    __m256 fx = _mm256_add_ps(_mm256_set1_ps(x + 0.5f), _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f));
+    __m256 fy = _mm256_set1_ps(y + 0.5f);
+    __m256i result = _mm256_setzero_si256();
+    for (int c = 0; c < 4; c++)
+    {
+        __m256 v = _mm256_add_ps(_mm256_set1_ps(block.plane[c][0]),
+            _mm256_add_ps(_mm256_mul_ps(fx, _mm256_set1_ps(block.plane[c][1])), _mm256_mul_ps(fy, _mm256_set1_ps(block.plane[c][2]))));
+        v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+        __m256i byte = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+        result = _mm256_or_si256(result, _mm256_slli_epi32(byte, c * 8));
+    }
+    return result;
+}
+
+// All eight pixels in one register.
+RASTER_TARGET_AVX2 static void fillAVX2(const RasterBlock& block, uint32_t* pixels, int stride)
+{
+    __m256i step[3], blockStep[3], rowE[3];
+    for (int k = 0; k < 3; k++)
+    {
+        int d = block.dx[k];
+        step[k] = _mm256_setr_epi32(0, d, 2 * d, 3 * d, 4 * d, 5 * d, 6 * d, 7 * d);
+        blockStep[k] = _mm256_set1_epi32(8 * d);
+        rowE[k] = _mm256_set1_epi32(block.e[k]);
+    }
+    const __m256i minusOne = _mm256_set1_epi32(-1);
+    const __m256i flatColor = _mm256_set1_epi32((int)block.color);
+
+    for (int row = 0; row < block.rows; row++)
+    {
+        int y = block.y0 + row;
+        uint32_t* dst = pixels + (size_t)y * stride + block.x0;
+        __m256i e[3];
+        for (int k = 0; k < 3; k++)
+            e[k] = _mm256_add_epi32(rowE[k], step[k]);
+        for (int b = 0; b < block.blocks; b++, dst += 8)
+        {
+            __m256i inside = _mm256_cmpgt_epi32(_mm256_or_si256(_mm256_or_si256(e[0], e[1]), e[2]), minusOne);
+            if (!_mm256_testz_si256(inside, inside))
+            {
+                __m256i src = block.flat ? flatColor : shadeAVX2(block, block.x0 + b * 8, y);
+                __m256i old = _mm256_loadu_si256((const __m256i*)dst);
+                _mm256_storeu_si256((__m256i*)dst, _mm256_blendv_epi8(old, src, inside));
+            }
+            for (int k = 0; k < 3; k++)
+                e[k] = _mm256_add_epi32(e[k], blockStep[k]);
+        }
+        for (int k = 0; k < 3; k++)
+            rowE[k] = _mm256_add_epi32(rowE[k], _mm256_set1_epi32(block.dy[k]));
+    }
+}
+
+static bool cpuHasAVX2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    // the OS also has to save the upper halves of the registers on context switches
+    __cpuid(info, 1);
+    if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+SoftwareRasterizer::SoftwareRasterizer(unsigned int threads)
+    : pool(threads), fill(fillScalar)
+{
+#ifdef RASTER_X86
+    fill = cpuHasAVX2() ? fillAVX2 : fillSSE2;
+#endif
+}
+
+const char* SoftwareRasterizer::simdPath() const
+{
+#ifdef RASTER_X86
+    if (fill == fillAVX2)
+        return "avx2";
+    if (fill == fillSSE2)
+        return "sse2";
+#endif
+    return "scalar";
+}
+
+void SoftwareRasterizer::resize(int newWidth, int newHeight)
+{
+    if (newWidth == width && newHeight == height)
+        return;
+    width = newWidth;
+    height = newHeight;
+    tilesX = (width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    tilesY = (height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    stride = tilesX * RASTER_TILE_SIZE;
+    pixels.assign((size_t)stride * tilesY * RASTER_TILE_SIZE, 0);
+    bins.resize(tilesX * tilesY);
+}
+
+void SoftwareRasterizer::clear(float r, float g, float b, float a)
+{
+    clearPending = true;
+    clearValue = packColor(saturate(r), saturate(g), saturate(b), saturate(a));
+}
+
+// Rounds a 1/16 pixel position to the first pixel whose center is at or after it.
+static int firstPixel(int64_t subpixel)
+{
+    return (int)std::ceil((subpixel - SUBPIXEL_ONE / 2) / (double)SUBPIXEL_ONE);
+}
+
+static int lastPixel(int64_t subpixel)
+{
+    return (int)std::floor((subpixel - SUBPIXEL_ONE / 2) / (double)SUBPIXEL_ONE);
+}
+
+void SoftwareRasterizer::setupTriangle(const MeshVertex& v0, const MeshVertex& v1, const MeshVertex& v2)
+{
+    const MeshVertex* v[3] = { &v0, &v1, &v2 };
+    int64_t x[3], y[3];
+    for (int i = 0; i < 3; i++)
+    {
+        // same mapping as the viewport transform
+        float px = std::min(std::max((v[i]->x + 1.0f) * 0.5f * width, (float)-GUARD_BAND), (float)(width + GUARD_BAND));
+        float py = std::min(std::max((v[i]->y + 1.0f) * 0.5f * height, (float)-GUARD_BAND), (float)(height + GUARD_BAND));
+        x[i] = (int64_t)std::lround(px * SUBPIXEL_ONE);
+        y[i] = (int64_t)std::lround(py * SUBPIXEL_ONE);
+    }
+
+    int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area == 0)
+        return;
+    // make the triangle counter-clockwise, so the inside is on the left of every edge
+    if (area < 0)
+    {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(v[1], v[2]);
+        area = -area;
+    }
+
+    Triangle t;
+    t.minX = std::max(firstPixel(std::min({ x[0], x[1], x[2] })), 0);
+    t.minY = std::max(firstPixel(std::min({ y[0], y[1], y[2] })), 0);
+    t.maxX = std::min(lastPixel(std::max({ x[0], x[1], x[2] })), width - 1);
+    t.maxY = std::min(lastPixel(std::max({ y[0], y[1], y[2] })), height - 1);
+    if (t.minX > t.maxX || t.minY > t.maxY)
+        return;
+
+    for (int i = 0; i < 3; i++)
+    {
+        int j = (i + 1) % 3;
+        int64_t dx = x[j] - x[i], dy = y[j] - y[i];
+        t.a[i] = -dy;
+        t.b[i] = dx;
+        t.c[i] = dy * x[i] - dx * y[i];
+        // Top-left rule: a pixel exactly on an edge belongs to the triangle only if the edge is a left edge
+        // (going down) or a top edge (horizontal, going left). On the other edges E > 0 is needed, i.e. E - 1 >= 0.
+        bool topLeft = dy < 0 || (dy == 0 && dx < 0);
+        if (!topLeft)
+            t.c[i] -= 1;
+    }
+
+    const float* c0 = &v[0]->r;
+    const float* c1 = &v[1]->r;
+    const float* c2 = &v[2]->r;
+    t.flat = memcmp(c0, c1, 4 * sizeof(float)) == 0 && memcmp(c0, c2, 4 * sizeof(float)) == 0;
+    if (t.flat)
+        t.color = packColor(saturate(c0[0]), saturate(c0[1]), saturate(c0[2]), saturate(c0[3]));
+    else
+    {
+        // Every channel as a plane over the screen, which is what the GPU interpolates in 2D.
+        float fx0 = x[0] / (float)SUBPIXEL_ONE, fy0 = y[0] / (float)SUBPIXEL_ONE;
+        float ex1 = (x[1] - x[0]) / (float)SUBPIXEL_ONE, ey1 = (y[1] - y[0]) / (float)SUBPIXEL_ONE;
+        float ex2 = (x[2] - x[0]) / (float)SUBPIXEL_ONE, ey2 = (y[2] - y[0]) / (float)SUBPIXEL_ONE;
+        float determinant = ex1 * ey2 - ex2 * ey1;
+        for (int c = 0; c < 4; c++)
+        {
+            float d1 = c1[c] - c0[c], d2 = c2[c] - c0[c];
+            float ddx = (d1 * ey2 - d2 * ey1) / determinant;
+            float ddy = (d2 * ex1 - d1 * ex2) / determinant;
+            t.plane[c][0] = c0[c] - ddx * fx0 - ddy * fy0;
+            t.plane[c][1] = ddx;
+            t.plane[c][2] = ddy;
+        }
+    }
+    triangles.push_back(t);
+}
+
+void SoftwareRasterizer::drawTriangles(const MeshVertex* vertices, unsigned int count)
+{
+    for (unsigned int i = 0; i + 2 < count; i += 3)
+        setupTriangle(vertices[i], vertices[i + 1], vertices[i + 2]);
+}
+
+void SoftwareRasterizer::drawRects(const RectInstance* rects, unsigned int count, const MaterialData* materials, unsigned int materialCount)
+{
+    static const MaterialData missing = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const RectInstance& r = rects[i];
+        const MaterialData& material = r.material < materialCount ? materials[r.material] : missing;
+        float color[4];
+        for (int c = 0; c < 4; c++)
+            color[c] = ((r.color >> (c * 8)) & 0xFF) / 255.0f * material.color[c];
+
+        MeshVertex corners[4] = {
+            { r.x, r.y, color[0], color[1], color[2], color[3] },
+            { r.x + r.w, r.y, color[0], color[1], color[2], color[3] },
+            { r.x + r.w, r.y + r.h, color[0], color[1], color[2], color[3] },
+            { r.x, r.y + r.h, color[0], color[1], color[2], color[3] }
+        };
+        setupTriangle(corners[0], corners[1], corners[2]);
+        setupTriangle(corners[0], corners[2], corners[3]);
+    }
+}
+
+void SoftwareRasterizer::flush()
+{
+    if (triangles.empty() && !clearPending)
+        return;
+
+    // Binning stays on one thread, it is cheap next to rasterizing and keeps every bin in submission order.
+    PROFILE_ZONE("SoftwareRasterizer::flush");
+    for (std::vector<unsigned int>& bin : bins)
+        bin.clear();
+    for (unsigned int i = 0; i < (unsigned int)triangles.size(); i++)
+    {
+        const Triangle& t = triangles[i];
+        for (int ty = t.minY / RASTER_TILE_SIZE; ty <= t.maxY / RASTER_TILE_SIZE; ty++)
+            for (int tx = t.minX / RASTER_TILE_SIZE; tx <= t.maxX / RASTER_TILE_SIZE; tx++)
+                bins[ty * tilesX + tx].push_back(i);
+    }
+
+    pool.parallelFor(tilesX * tilesY, [this](unsigned int tile) { rasterizeTile(tile); });
+    triangles.clear();
+    clearPending = false;
+}
+
+void SoftwareRasterizer::rasterizeTile(unsigned int tile)
+{
+    PROFILE_ZONE("rasterizeTile");
+    int tileX0 = (tile % tilesX) * RASTER_TILE_SIZE, tileY0 = (tile / tilesX) * RASTER_TILE_SIZE;
+    int tileX1 = tileX0 + RASTER_TILE_SIZE - 1, tileY1 = tileY0 + RASTER_TILE_SIZE - 1;
+    if (clearPending)
+        for (int y = tileY0; y <= tileY1; y++)
+            std::fill_n(pixels.begin() + (size_t)y * stride + tileX0, RASTER_TILE_SIZE, clearValue);
+
+    for (unsigned int index : bins[tile])
+    {
+        const Triangle& t = triangles[index];
+        RasterBlock block;
+        // start on a multiple of 8, the pixels left of the triangle fail the edge test anyway
+        block.x0 = std::max(t.minX, tileX0) & ~7;
+        block.y0 = std::max(t.minY, tileY0);
+        int x1 = std::min(t.maxX, tileX1), y1 = std::min(t.maxY, tileY1);
+        block.blocks = (x1 - block.x0) / 8 + 1;
+        block.rows = y1 - block.y0 + 1;
+
+        /*
+        Look at every edge function at the corners of the block. An edge the whole block is outside of
+        rejects the triangle, an edge the whole block is inside of is left out of the per pixel test.
+        The remaining edges cross the block, so their values inside it are small enough for 32 bits.
+        */
+        int64_t px0 = (int64_t)block.x0 * SUBPIXEL_ONE + SUBPIXEL_ONE / 2;
+        int64_t py0 = (int64_t)block.y0 * SUBPIXEL_ONE + SUBPIXEL_ONE / 2;
+        int64_t px1 = px0 + (int64_t)(block.blocks * 8 - 1) * SUBPIXEL_ONE;
+        int64_t py1 = py0 + (int64_t)(block.rows - 1) * SUBPIXEL_ONE;
+        bool outside = false;
+        for (int k = 0; k < 3 && !outside; k++)
+        {
+            int64_t e00 = t.a[k] * px0 + t.b[k] * py0 + t.c[k];
+            int64_t e10 = t.a[k] * px1 + t.b[k] * py0 + t.c[k];
+            int64_t e01 = t.a[k] * px0 + t.b[k] * py1 + t.c[k];
+            int64_t e11 = t.a[k] * px1 + t.b[k] * py1 + t.c[k];
+            int64_t lowest = std::min({ e00, e10, e01, e11 }), highest = std::max({ e00, e10, e01, e11 });
+            if (highest < 0)
+                outside = true;
+            else if (lowest >= 0)
+                block.e[k] = block.dx[k] = block.dy[k] = 0;
+            else
+            {
+                block.e[k] = (int)e00;
+                block.dx[k] = (int)(t.a[k] * SUBPIXEL_ONE);
+                block.dy[k] = (int)(t.b[k] * SUBPIXEL_ONE);
+            }
+        }
+        if (outside)
+            continue;
+
+        block.flat = t.flat;
+        block.color = t.color;
+        if (!t.flat)
+            memcpy(block.plane, t.plane, sizeof(block.plane));
+        fill(block, pixels.data(), stride);
+    }
+}
+
+void SoftwareRasterizer::readPixels(std::vector<unsigned char>& rgba) const
+{
+    rgba.resize((size_t)width * height * 4);
+    // packColor() puts red in the lowest byte, so on little-endian machines every pixel already reads R, G, B, A
+    for (int y = 0; y < height; y++)
+        memcpy(&rgba[(size_t)(height - 1 - y) * width * 4], &pixels[(size_t)y * stride], (size_t)width * 4);
+}
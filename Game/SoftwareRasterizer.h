@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "IndexedMesh.h"
+#include "InstancedRects.h"
+#include "MaterialTable.h"
+#include "ThreadPool.h"
+
+// Width and height of the screen tiles the rasterizer works on in parallel.
+const int RASTER_TILE_SIZE = 64;
+
+// A triangle clipped to one tile, in the form the inner loops want it.
+struct RasterBlock
+{
+    int x0, y0;          // first pixel, x0 is a multiple of 8
+    int blocks, rows;    // 8 pixel wide blocks per row, number of rows
+    int e[3];            // edge functions at the center of pixel (x0, y0), >= 0 means inside
+    int dx[3], dy[3];    // change of the edge functions per pixel in x and y
+    bool flat;
+    uint32_t color;      // packColor() of a flat triangle
+    float plane[4][3];   // r, g, b, a as value at pixel (0, 0), change per pixel in x, in y
+};
+
+/*
+Draws the same triangles and rectangles as the OpenGL path on the CPU, for machines without any GPU.
+
+Triangles are collected until flush(). They are then binned into 64x64 pixel tiles, and the tiles are
+rasterized in parallel on a work-stealing thread pool. Every tile sees its triangles in submission order,
+so the picture is the same as drawing them one after another. Inside a tile the three edge functions are
+evaluated for 8 pixels at once, with AVX2 when the CPU has it and two SSE2 halves otherwise.
+
+Vertices are snapped to 1/16 pixel and edges follow the top-left fill rule like GPUs do, so two triangles
+sharing an edge never both or neither draw a pixel on it. Pixels are stored bottom row first like OpenGL.
+Blending is off, the same as the panels are drawn with.
+*/
+class SoftwareRasterizer
+{
+public:
+    // 0 threads means one per hardware thread.
+    explicit SoftwareRasterizer(unsigned int threads = 0);
+
+    void resize(int width, int height);
+    // Clears the whole framebuffer at the start of the next flush().
+    void clear(float r, float g, float b, float a);
+
+    // Triangles in normalized device coordinates, three vertices each, colors interpolated like the GPU does.
+    void drawTriangles(const MeshVertex* vertices, unsigned int count);
+    // Rectangles as drawn by InstancedRects without shader features. Materials past materialCount read as zero, like the shader's.
+    void drawRects(const RectInstance* rects, unsigned int count, const MaterialData* materials, unsigned int materialCount);
+
+    // Rasterizes everything drawn since the last flush.
+    void flush();
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    unsigned int threadCount() const { return pool.size(); }
+    // Which inner loop is used: "avx2", "sse2" or "scalar".
+    const char* simdPath() const;
+
+    // Tightly packed RGBA rows, top row first, like OffscreenTarget::readPixels().
+    void readPixels(std::vector<unsigned char>& rgba) const;
+
+private:
+    struct Triangle
+    {
+        int64_t a[3], b[3], c[3]; // edge functions a * x + b * y + c in 1/16 pixels, top-left bias included
+        int minX, minY, maxX, maxY; // covered pixels, clipped to the screen
+        bool flat;
+        uint32_t color;
+        float plane[4][3];
+    };
+    typedef void (*FillFunction)(const RasterBlock& block, uint32_t* pixels, int stride);
+
+    void setupTriangle(const MeshVertex& v0, const MeshVertex& v1, const MeshVertex& v2);
+    void rasterizeTile(unsigned int tile);
+
+    ThreadPool pool;
+    FillFunction fill;
+    int width = 0, height = 0;
+    int tilesX = 0, tilesY = 0;
+    // padded to whole tiles so the inner loops never need to check the screen edge
+    int stride = 0;
+    std::vector<uint32_t> pixels;
+
+    std::vector<Triangle> triangles;
+    std::vector<std::vector<unsigned int>> bins;
+    bool clearPending = false;
+    uint32_t clearValue = 0;
+};
@@ -0,0 +1,141 @@
+#include <glad/glad.h>
+#include <iostream>
+
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "Profiler.h"
+#include "StreamBuffer.h"
+
+bool StreamBuffer::init(size_t segmentBytes, bool persistentIfSupported)
+{
+    destroy();
+    usePersistent = persistentIfSupported;
+    stats = StreamStats();
+    return createBuffer(segmentBytes > 0 ? segmentBytes : 1);
+}
+
+void StreamBuffer::destroy()
+{
+    unmap();
+    for (unsigned int old : retired)
+        glState.deleteBuffer(old);
+    retired.clear();
+    // deleting a mapped buffer unmaps it
+    if (buffer)
+        glState.deleteBuffer(buffer);
+    buffer = 0;
+    mapped = nullptr;
+    segmentSize = 0;
+    segmentCount = 0;
+    segment = 0;
+    used = 0;
+}
+
+bool StreamBuffer::createBuffer(size_t segmentBytes)
+{
+    segmentSize = segmentBytes;
+    segmentCount = frameSync.framesInFlight();
+    segment = 0;
+    used = 0;
+    frame = frameSync.frameNumber();
+    for (uint64_t& written : segmentFrames)
+        written = 0;
+    size_t size = segmentSize * segmentCount;
+    persistent = usePersistent && glExt.bufferStorage;
+
+    glGenBuffers(1, &buffer);
+    glState.bindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (persistent)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glExt.bufferStorageCreate(GL_ARRAY_BUFFER, size, NULL, flags);
+        mapped = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+        if (!mapped)
+        {
+            // storage that can't be mapped is no use, start over with a buffer that can be orphaned
+            std::cout << "ERROR::STREAM_BUFFER::PERSISTENT_MAP_FAILED, falling back to unsynchronized mapping" << std::endl;
+            glState.deleteBuffer(buffer);
+            glGenBuffers(1, &buffer);
+            glState.bindBuffer(GL_ARRAY_BUFFER, buffer);
+            persistent = false;
+        }
+    }
+    if (!persistent)
+        glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+    glState.bindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+StreamAllocation StreamBuffer::map(size_t bytes, size_t alignment)
+{
+    StreamAllocation allocation;
+    if (!buffer)
+        return allocation;
+    unmap();
+    if (frameSync.frameNumber() != frame)
+        startFrame(frameSync.frameNumber());
+    size_t offset = (used + alignment - 1) & ~(alignment - 1);
+    if (offset + bytes > segmentSize)
+    {
+        // Moving on to the next segment here could overwrite data of this frame that hasn't been drawn yet,
+        // so the frame gets a bigger ring instead. Draws already issued keep reading the old buffer.
+        PROFILE_ZONE("StreamBuffer::grow");
+        size_t newSize = segmentSize * 2;
+        while (newSize < offset + bytes)
+            newSize *= 2;
+        retired.push_back(buffer);
+        createBuffer(newSize);
+        stats.grows++;
+        offset = 0;
+    }
+    used = offset + bytes;
+    segmentFrames[segment] = frame;
+    stats.bytes += bytes;
+
+    allocation.buffer = buffer;
+    allocation.offset = segment * segmentSize + offset;
+    if (persistent)
+        allocation.data = mapped + allocation.offset;
+    else
+    {
+        // nothing the GPU may still read lives in this range, so there is no need to wait for it
+        glState.bindBuffer(GL_ARRAY_BUFFER, buffer);
+        allocation.data = glMapBufferRange(GL_ARRAY_BUFFER, allocation.offset, bytes,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        mappedRange = allocation.data != nullptr;
+    }
+    return allocation;
+}
+
+void StreamBuffer::unmap()
+{
+    // coherent persistent memory needs nothing, writes are visible to the next draw
+    if (!mappedRange)
+        return;
+    glState.bindBuffer(GL_ARRAY_BUFFER, buffer);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    mappedRange = false;
+}
+
+void StreamBuffer::startFrame(uint64_t number)
+{
+    // the draws of earlier frames have all been issued by now
+    for (unsigned int old : retired)
+        glState.deleteBuffer(old);
+    retired.clear();
+    frame = number;
+    // a frame that wrote nothing leaves its segment to the next one
+    if (used == 0)
+        return;
+    segment = (segment + 1) % segmentCount;
+    used = 0;
+    if (persistent)
+        frameSync.waitForFrame(segmentFrames[segment]);
+    else if (segment == 0)
+    {
+        // the driver hands out fresh storage and frees the old one once the GPU is done with it
+        glState.bindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, segmentSize * segmentCount, NULL, GL_STREAM_DRAW);
+        stats.orphans++;
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "FrameSync.h"
+
+// Where map() put the data: write through data, draw from buffer at offset.
+struct StreamAllocation
+{
+    void* data = nullptr; // null if the buffer could not be created
+    unsigned int buffer = 0;
+    size_t offset = 0;
+};
+
+struct StreamStats
+{
+    size_t bytes;          // handed out by map()
+    unsigned int orphans;  // times the storage was orphaned, without buffer storage
+    unsigned int grows;    // times a frame didn't fit and the ring was replaced by a bigger one
+};
+
+/*
+A vertex buffer for data that changes every frame, written straight into memory the GPU reads from.
+
+The buffer is a ring with one segment per frame in flight (see FrameSync), and every frame writes into the
+next one. With ARB_buffer_storage the whole ring is created with glBufferStorage and mapped once, persistent
+and coherent, so map() is pointer arithmetic. A segment is only written again once frameSync says the frame
+that wrote it last is done. FrameSync normally waited for that frame already before this one began, so
+this costs nothing unless the GPU is far behind, and then the wait counts as the frame's stall.
+
+Without buffer storage (plain OpenGL 3.3) every map() is a glMapBufferRange with
+GL_MAP_UNSYNCHRONIZED_BIT, which the driver doesn't synchronize with the GPU either. Instead of waiting for
+frames the storage is orphaned with glBufferData(NULL) whenever the ring starts over, so the GPU keeps
+reading the old storage while the new one is written.
+
+A frame that needs more than a segment holds gets a bigger ring on the spot. The old buffer is deleted in
+a later frame, once the draws reading from it have been issued.
+*/
+class StreamBuffer
+{
+public:
+    // Creates the ring with room for segmentBytes per frame, one segment per frameSync.framesInFlight().
+    // persistentIfSupported = false always takes the 3.3 path, e.g. to compare the two.
+    bool init(size_t segmentBytes, bool persistentIfSupported = true);
+    void destroy();
+
+    // Space for bytes in the segment of frameSync's current frame, starting at a multiple of alignment (a power
+    // of two). Call unmap() once it is written and before anything draws from it.
+    StreamAllocation map(size_t bytes, size_t alignment = 16);
+    void unmap();
+
+    bool isPersistent() const { return persistent; }
+    const StreamStats& getStats() const { return stats; }
+    void resetStats() { stats = StreamStats(); }
+
+private:
+    bool createBuffer(size_t segmentBytes);
+    // The first map() of a frame: moves on to the next segment.
+    void startFrame(uint64_t number);
+
+    unsigned int buffer = 0;
+    bool persistent = false;
+    bool usePersistent = true;
+    unsigned char* mapped = nullptr; // the whole ring, persistent only
+    bool mappedRange = false;        // a glMapBufferRange waiting for unmap(), without buffer storage
+    size_t segmentSize = 0;
+    unsigned int segmentCount = 0;
+    unsigned int segment = 0;
+    size_t used = 0;    // bytes of the current segment handed out
+    uint64_t frame = 0; // frameSync frame of the last map()
+    uint64_t segmentFrames[MAX_FRAMES_IN_FLIGHT] = {}; // the frame that wrote each segment last
+    std::vector<unsigned int> retired; // outgrown buffers, deleted in the next frame
+    StreamStats stats = StreamStats();
+};
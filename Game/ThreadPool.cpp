@@ -0,0 +1,106 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int threads)
+{
+    if (threads == 0)
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (unsigned int i = 0; i < threads; i++)
+        queues.emplace_back(new WorkQueue);
+    // queue 0 belongs to the thread calling parallelFor()
+    for (unsigned int i = 1; i < threads; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::parallelFor(unsigned int count, const std::function<void(unsigned int)>& newTask)
+{
+    if (count == 0)
+        return;
+    steals = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Set before any item is queued: a worker that is still busy with the last job may pick up
+        // a new item as soon as it lands in a queue.
+        task = &newTask;
+        remaining = count;
+        unsigned int threads = size();
+        for (unsigned int q = 0; q < threads; q++)
+        {
+            std::lock_guard<std::mutex> queueLock(queues[q]->mutex);
+            for (unsigned int i = count * q / threads; i < count * (q + 1) / threads; i++)
+                queues[q]->items.push_back(i);
+        }
+        generation++;
+    }
+    wake.notify_all();
+
+    while (runOne(0))
+        ;
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return remaining == 0; });
+}
+
+bool ThreadPool::runOne(unsigned int self)
+{
+    unsigned int item = 0;
+    bool found = false;
+    {
+        WorkQueue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.items.empty())
+        {
+            item = own.items.back();
+            own.items.pop_back();
+            found = true;
+        }
+    }
+    for (unsigned int k = 1; k < size() && !found; k++)
+    {
+        WorkQueue& victim = *queues[(self + k) % size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.items.empty())
+        {
+            item = victim.items.front();
+            victim.items.pop_front();
+            found = true;
+            steals++;
+        }
+    }
+    if (!found)
+        return false;
+
+    (*task)(item);
+    if (--remaining == 0)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.notify_all();
+    }
+    return true;
+}
+
+void ThreadPool::workerLoop(unsigned int self)
+{
+    unsigned int seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return quit || generation != seen; });
+            if (quit)
+                return;
+            seen = generation;
+        }
+        while (runOne(self))
+            ;
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+A fixed set of worker threads that run parallelFor() jobs.
+Every thread, including the one calling parallelFor(), owns a queue of work items. The items are handed out
+in contiguous ranges, one range per queue; a thread works from the back of its own queue and, once that is
+empty, steals from the front of the others. Neighbouring items tend to cost about the same, so a thread that
+got cheap items takes over the tail of a slower thread's range instead of sitting idle.
+*/
+class ThreadPool
+{
+public:
+    // 0 threads means one per hardware thread. The calling thread counts as one of them.
+    explicit ThreadPool(unsigned int threads = 0);
+    ~ThreadPool();
+
+    unsigned int size() const { return (unsigned int)queues.size(); }
+
+    // Runs task(i) for every i in [0, count) and returns when all of them finished. Not reentrant.
+    void parallelFor(unsigned int count, const std::function<void(unsigned int)>& task);
+
+    // How many items were stolen during the last parallelFor().
+    unsigned int lastSteals() const { return steals; }
+
+private:
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<unsigned int> items;
+    };
+
+    bool runOne(unsigned int self);
+    void workerLoop(unsigned int self);
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    const std::function<void(unsigned int)>* task = nullptr;
+    unsigned int generation = 0;
+    bool quit = false;
+    std::atomic<unsigned int> remaining{ 0 };
+    std::atomic<unsigned int> steals{ 0 };
+};
@@ -0,0 +1,58 @@
+#include <glad/glad.h>
+#include <cstring>
+
+#include "GLState.h"
+#include "UniformRing.h"
+
+UniformRing uniformRing;
+
+bool UniformRing::init(size_t bytesPerFrame, bool persistentIfSupported)
+{
+    destroy();
+    GLint queried = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &queried);
+    // Every driver reports a power of two, which StreamBuffer's alignment needs. Round up just in case.
+    offsetAlignment = 16;
+    while (offsetAlignment < (size_t)queried)
+        offsetAlignment *= 2;
+    ready = stream.init(align(bytesPerFrame), persistentIfSupported);
+    return ready;
+}
+
+void UniformRing::destroy()
+{
+    stream.destroy();
+    ready = false;
+}
+
+StreamAllocation UniformRing::map(size_t bytes)
+{
+    return stream.map(align(bytes), offsetAlignment);
+}
+
+UniformSlice UniformRing::upload(const void* data, size_t size)
+{
+    UniformSlice slice;
+    StreamAllocation allocation = map(size);
+    if (!allocation.data)
+        return slice;
+    memcpy(allocation.data, data, size);
+    unmap();
+    slice.buffer = allocation.buffer;
+    slice.offset = allocation.offset;
+    slice.size = size;
+    return slice;
+}
+
+void UniformRing::bind(unsigned int index, const UniformSlice& slice)
+{
+    glState.bindBufferRange(GL_UNIFORM_BUFFER, index, slice.buffer, slice.offset, slice.size);
+}
+
+void UniformRing::attachToProgram(unsigned int program)
+{
+    // no layout(binding = ...) in GLSL 3.30, the same as for the material table
+    unsigned int blockIndex = glGetUniformBlockIndex(program, "DrawConstants");
+    if (blockIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, blockIndex, DRAW_CONSTANTS_BINDING);
+}
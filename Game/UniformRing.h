@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+
+#include "StreamBuffer.h"
+
+// Uniform buffer binding point for the constants of one draw, see UniformRing.
+const unsigned int DRAW_CONSTANTS_BINDING = 1;
+
+// A block handed out by the uniformRing, ready to be bound with bind().
+struct UniformSlice
+{
+    unsigned int buffer = 0; // 0 if the ring could not be created
+    size_t offset = 0;
+    size_t size = 0;
+};
+
+/*
+A per-frame linear allocator for uniform blocks, so per-draw data like colors and rectangles doesn't turn
+into a handful of glUniform calls per draw.
+
+All blocks live in one big uniform buffer, a StreamBuffer with a segment per frame in flight: allocating is
+moving a pointer along the current frame's segment, and the next frame starts over in the next one once
+frameSync says the GPU is done with it. Every block starts at a multiple of GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT,
+which is what glBindBufferRange needs, so a draw only has to bind its slice of the buffer.
+
+The cheapest use is to write the blocks of many draws in one go: map() room for all of them, copy each to a
+multiple of alignment(), unmap() once and bind a slice per draw. RenderQueue does that for the constants of
+every draw it flushes. upload() is the same for a single block.
+*/
+class UniformRing
+{
+public:
+    // Room for bytesPerFrame of blocks in each frame; a frame that needs more gets a bigger buffer.
+    bool init(size_t bytesPerFrame, bool persistentIfSupported = true);
+    void destroy();
+    bool isReady() const { return ready; }
+
+    // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, and bytes rounded up to it.
+    size_t alignment() const { return offsetAlignment; }
+    size_t align(size_t bytes) const { return (bytes + offsetAlignment - 1) & ~(offsetAlignment - 1); }
+
+    // Room for bytes in the current frame, starting at an aligned offset. Call unmap() once it is written.
+    StreamAllocation map(size_t bytes);
+    void unmap() { stream.unmap(); }
+    // Copies one block into the current frame.
+    UniformSlice upload(const void* data, size_t size);
+
+    // Binds a slice to a uniform buffer binding point through glState.
+    static void bind(unsigned int index, const UniformSlice& slice);
+    // Points a program's "DrawConstants" block at DRAW_CONSTANTS_BINDING. Needs to happen once per program.
+    static void attachToProgram(unsigned int program);
+
+    const StreamStats& getStats() const { return stream.getStats(); }
+
+private:
+    StreamBuffer stream;
+    size_t offsetAlignment = 256;
+    bool ready = false;
+};
+
+// The ring the renderer allocates per-draw constants from.
+extern UniformRing uniformRing;
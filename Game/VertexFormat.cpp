@@ -0,0 +1,26 @@
+#include "VertexFormat.h"
+
+static bool isUnsigned(GLenum type)
+{
+    return type == GL_UNSIGNED_BYTE || type == GL_UNSIGNED_SHORT || type == GL_UNSIGNED_INT;
+}
+
+std::string vertexInputsGLSL(const VertexLayout& layout)
+{
+    std::string glsl;
+    for (unsigned int i = 0; i < layout.attributeCount; i++)
+    {
+        const VertexAttribute& attribute = layout.attributes[i];
+        if (!attribute.name)
+            continue;
+        // float, vec2.. for everything converted to float, int/uint and ivec/uvec for integer attributes
+        std::string type;
+        if (attribute.integer)
+            type = attribute.size == 1 ? (isUnsigned(attribute.type) ? "uint" : "int")
+                : std::string(isUnsigned(attribute.type) ? "uvec" : "ivec") + std::to_string(attribute.size);
+        else
+            type = attribute.size == 1 ? "float" : "vec" + std::to_string(attribute.size);
+        glsl += "layout (location = " + std::to_string(attribute.location) + ") in " + type + " " + attribute.name + ";\n";
+    }
+    return glsl;
+}
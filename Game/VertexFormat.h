@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+// One vertex shader input read from a vertex buffer.
+struct VertexAttribute
+{
+    unsigned int location;
+    int size;            // components, 1..4
+    GLenum type;         // GL_FLOAT, GL_SHORT, GL_UNSIGNED_BYTE, ...
+    bool normalized;     // integer types mapped to 0..1 (unsigned) or -1..1 (signed)
+    bool integer;        // read as int or uint in the shader instead of being converted to float
+    unsigned int offset; // from the start of a vertex
+    const char* name;    // of the input in the shader, for vertexInputsGLSL()
+};
+
+// The attributes sourced from one vertex buffer binding, and how far apart its vertices are.
+struct VertexLayout
+{
+    const VertexAttribute* attributes;
+    unsigned int attributeCount;
+    int stride;
+    unsigned int divisor; // 0 per vertex, 1 per instance
+};
+
+/*
+The "layout (location = N) in <type> <name>;" declarations of a layout's attributes, so a shader's inputs can't
+disagree with the buffer. The GLSL type only depends on how an attribute is read: a normalized GL_SHORT pair
+is a vec2 just like two floats, so packing a vertex tighter doesn't change the rest of the shader.
+*/
+std::string vertexInputsGLSL(const VertexLayout& layout);
+
+// 0..1 to a GL_UNSIGNED_BYTE read back as a normalized float. Out of range values are clamped, so they can't
+// spill into the neighbouring byte.
+inline unsigned int packUnorm8(float value)
+{
+    return (unsigned int)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+// Packs a color into 4 bytes so it can be read back as a normalized vec4 in the shader.
+inline unsigned int packColor(float r, float g, float b, float a)
+{
+    return packUnorm8(r) | (packUnorm8(g) << 8) | (packUnorm8(b) << 16) | (packUnorm8(a) << 24);
+}
+
+// -1..1 to a GL_SHORT read back as a normalized float. OpenGL maps -32767..32767 back to -1..1, so a normalized
+// device coordinate keeps a precision of about 1/16000 of the screen.
+inline int16_t packNormalizedShort(float value)
+{
+    float clamped = std::min(std::max(value, -1.0f), 1.0f);
+    return (int16_t)(clamped * 32767.0f + (clamped < 0.0f ? -0.5f : 0.5f));
+}
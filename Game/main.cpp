@@ -1,60 +1,201 @@
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <cstring>
 #include <iostream>
 
+#include "Benchmark.h"
+#include "DamageTracker.h"
+#include "FrameSync.h"
+#include "FrameTimer.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "Headless.h"
+#include "InstancedRects.h"
+#include "LayerCache.h"
+#include "MaterialTable.h"
+#include "PartialRedraw.h"
+#include "ProgramCache.h"
+#include "Profiler.h"
+#include "Redraw.h"
+#include "RenderQueue.h"
+#include "ShaderLibrary.h"
+#include "ShaderPipeline.h"
+#include "SoftwareRasterizer.h"
+#include "UniformRing.h"
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void error_callback(int error, const char* description);
 static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void character_callback(GLFWwindow* window, unsigned int codepoint);
+void window_refresh_callback(GLFWwindow* window);
 
 
 const unsigned int SCR_WIDTH = 640;
 const unsigned int SCR_HEIGHT = 480;
 
-// OpenGL Shading Language
-const char* vertexShaderSource = "#version 330 core\n"
-"layout (location = 0) in vec3 aPos;\n"
-"void main()\n"
-"{\n"
-"   gl_Position = vec4(aPos.x, aPos.y, aPos.z, 1.0);\n"
-"}\0";
-
-const char* fragmentShaderSource = "#version 330 core\n"
-"out vec4 FragColor;\n"
-"void main()\n"
-"{\n"
-"   FragColor = vec4(0.5f, 0.0f, 1.0f, 1.0f);\n"
-"}\n\0";
-
-const char* fragmentShaderSource2 = "#version 330 core\n"
-"out vec4 FragColor;\n"
-"void main()\n"
-"{\n"
-"   FragColor = vec4(1.0f, 1.0f, 0.0f, 1.0f);\n"
-"}\n\0";
-
-const char* fragmentShaderSource3 = "#version 330 core\n"
-"out vec4 FragColor;\n"
-"void main()\n"
-"{\n"
-"   FragColor = vec4(0.69f, 0.42f, 0.0f, 1.0f);\n"
-"}\n\0";
-
-const char* fragmentShaderSource4 = "#version 330 core\n"
-"out vec4 FragColor;\n"
-"void main()\n"
-"{\n"
-"   FragColor = vec4(0.5f, 0.5f, 0.5f, 1.0f);\n"
-"}\n\0";
-
-int main()
+// Material ids, in the order they are added to the material table in main().
+enum Material
+{
+    MATERIAL_PURPLE = 1,
+    MATERIAL_YELLOW,
+    MATERIAL_GREY,
+    MATERIAL_ORANGE
+};
+// Their colors, indexed by material id. Material 0 is the table's own white.
+const MaterialData materialColors[] = {
+    { { 1.0f,  1.0f,  1.0f, 1.0f } },
+    { { 0.5f,  0.0f,  1.0f, 1.0f } }, // MATERIAL_PURPLE
+    { { 1.0f,  1.0f,  0.0f, 1.0f } }, // MATERIAL_YELLOW
+    { { 0.5f,  0.5f,  0.5f, 1.0f } }, // MATERIAL_GREY
+    { { 0.69f, 0.42f, 0.0f, 1.0f } }  // MATERIAL_ORANGE
+};
+const unsigned int MATERIAL_COUNT = sizeof(materialColors) / sizeof(materialColors[0]);
+
+// The UI, back to front. Later panels are drawn on top of earlier ones.
+//    X,      Y,      W,     H,     color,       depth, material
+const RectInstance panels[] = {
+    { -1.0f,  -0.90f,  2.0f,  0.65f, COLOR_WHITE, 0.0f, MATERIAL_PURPLE, 0.0f }, // Bottom panel
+    { -1.0f,  -0.20f,  2.0f,  1.05f, COLOR_WHITE, 0.0f, MATERIAL_YELLOW, 0.0f }, // Main panel
+    { -1.0f,   0.85f,  2.0f,  0.15f, COLOR_WHITE, 0.0f, MATERIAL_GREY,   0.0f }, // Top panel
+    { -0.97f, -0.15f,  0.62f, 0.95f, COLOR_WHITE, 0.0f, MATERIAL_ORANGE, 0.0f }  // Side panel
+};
+const unsigned int TOP_PANEL = 2;
+const unsigned int SIDE_PANEL = 3;
+const unsigned int PANEL_COUNT = sizeof(panels) / sizeof(panels[0]);
+
+// The parts of the window that changed since the last frame.
+static DamageTracker damage;
+// Toggled with F2, changes the color of the side panel.
+static bool sidePanelHighlighted = false;
+// Layers kept as textures by the layer cache.
+enum CachedLayer
+{
+    LAYER_TOP_BAR = 1
+};
+static LayerCache layerCache;
+// Where the time of every frame goes, F4 prints a summary.
+static FrameTimer frameTimer;
+
+// Everything needed to draw the UI, shared by the window and the headless mode.
+struct Scene
+{
+    MaterialTable materials;
+    InstancedRects rects;
+    InstancedRects topBar;
+    // Draws are collected every frame and sorted to need as few state changes as possible.
+    RenderQueue queue;
+    bool sidePanelWasHighlighted = false;
+};
+
+static bool initScene(Scene& scene);
+static void updateScene(Scene& scene);
+static void drawScene(Scene& scene);
+static void destroyScene(Scene& scene);
+// Command line options, see main().
+struct Options
+{
+    bool benchmark = false;
+    bool headless = false;
+    bool software = false;
+    int frames = 1;
+    const char* output = NULL;
+    const char* timings = NULL;
+    const char* profile = NULL;
+    const char* shaderCache = "shadercache";
+    const char* shaders = NULL;
+    bool separateShaders = true;
+    bool directStateAccess = true;
+    unsigned int framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+};
+
+static int runWindowed(const Options& options);
+static int runHeadless(const Options& options);
+static int runSoftware(const Options& options);
+static bool exportTimings(const char* path);
+static void initExtensions(const Options& options, GLADloadproc loader);
+
+int main(int argc, char** argv)
+{
+    // command line options
+    //   --bench       measure the draw paths instead of showing the UI
+    //   --continuous  redraw every iteration instead of only when something changed
+    //   --headless    render without a window into an offscreen framebuffer, e.g. on a build agent
+    //   --software    like --headless, but rasterized on the CPU without any OpenGL
+    //   --frames N    how many frames --headless and --software draw (default 1)
+    //   --output FILE where --headless and --software save the last frame, as a PPM image
+    //   --timings FILE  saves the frame timings of the run when it ends, as JSON if FILE ends in .json, CSV otherwise
+    //   --profile FILE  records profiler zones from startup on and saves them as a Chrome trace when the run ends
+    //   --shader-cache DIR  where linked programs are kept between runs (default "shadercache")
+    //   --no-shader-cache   always compile and link from source
+    //   --frames-in-flight N  how many frames the CPU may get ahead of the GPU (default 3)
+    //   --no-separate-shaders  links every shader variant as one program even where program pipelines are supported
+    //   --no-dsa        creates buffers and vertex arrays by binding them, like on OpenGL 3.3, even where 4.5 is there
+    //   --shaders DIR   loads the shaders from DIR and reloads them while the window is open whenever they are saved
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--bench") == 0)
+            options.benchmark = true;
+        else if (strcmp(argv[i], "--continuous") == 0)
+            redraw.setContinuous(true);
+        else if (strcmp(argv[i], "--headless") == 0)
+            options.headless = true;
+        else if (strcmp(argv[i], "--software") == 0)
+            options.software = true;
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            options.frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            options.output = argv[++i];
+        else if (strcmp(argv[i], "--timings") == 0 && i + 1 < argc)
+            options.timings = argv[++i];
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+            options.profile = argv[++i];
+        else if (strcmp(argv[i], "--shader-cache") == 0 && i + 1 < argc)
+            options.shaderCache = argv[++i];
+        else if (strcmp(argv[i], "--no-shader-cache") == 0)
+            options.shaderCache = NULL;
+        else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+            options.framesInFlight = (unsigned int)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--no-separate-shaders") == 0)
+            options.separateShaders = false;
+        else if (strcmp(argv[i], "--no-dsa") == 0)
+            options.directStateAccess = false;
+        else if (strcmp(argv[i], "--shaders") == 0 && i + 1 < argc)
+            options.shaders = argv[++i];
+    }
+    // clamped to 1..MAX_FRAMES_IN_FLIGHT
+    frameSync.setFramesInFlight(options.framesInFlight);
+
+    if (options.profile)
+    {
+        profiler.start();
+        profiler.setThreadName("main");
+    }
+
+    int result;
+    if (options.software)
+        result = runSoftware(options);
+    else if (options.headless)
+        result = runHeadless(options);
+    else
+        result = runWindowed(options);
+
+    if (options.profile && !profiler.exportChromeTrace(options.profile))
+        result = EXIT_FAILURE;
+    return result;
+}
+
+static int runWindowed(const Options& options)
 {
     // glfw: initialize and configure
     // Handle Initialization failure
-    if (!glfwInit()) {
-        printf("Unable to initialize GLFW!\n");
-        return EXIT_FAILURE;
+    {
+        PROFILE_ZONE("glfwInit");
+        if (!glfwInit()) {
+            printf("Unable to initialize GLFW!\n");
+            return EXIT_FAILURE;
+        }
     }
     // Using OpenGL 3.3 and the CORE-profile.
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -63,7 +204,11 @@ int main()
 
     // glfw window creation
     // Creates the window, sets width, height, title etc..
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Very Pog UI design", NULL, NULL);
+    GLFWwindow* window;
+    {
+        PROFILE_ZONE("glfwCreateWindow");
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Very Pog UI design", NULL, NULL);
+    }
     if (window == NULL) {
         error_callback(404, "Window or OpenGL context creation failed!");
         glfwTerminate();
@@ -78,348 +223,431 @@ int main()
     // glad: load all OpenGL function pointers
     // We pass GLAD the function to load the address of the OpenGL function pointers which is OS-specific. 
     // GLFW gives us glfwGetProcAddress that defines the correct function based on which OS we're compiling for.
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
     {
-        error_callback(400, "Failed to initialize GLAD");
-        exit(EXIT_FAILURE);
+        PROFILE_ZONE("gladLoadGLLoader");
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+        {
+            error_callback(400, "Failed to initialize GLAD");
+            exit(EXIT_FAILURE);
+        }
     }
+    initExtensions(options, (GLADloadproc)glfwGetProcAddress);
 
-    // vertex shader
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
     /*
-    The glShaderSource function takes the shader object to compile to as its first argument. 
-    The second argument specifies how many strings we're passing as source code, which is only one. 
-    The third parameter is the actual source code of the vertex shader and we can leave the 4th parameter to NULL. 
+    Shader hot reload. The programs are rebuilt on a worker thread, which needs a context of its own.
+    An invisible window shares its objects with the main one, so the programs built there can be drawn with here.
     */
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-    // check for shader compile errors
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
+    GLFWwindow* reloadWindow = NULL;
+    if (options.shaders && !options.benchmark)
     {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        reloadWindow = glfwCreateWindow(1, 1, "shader reload", NULL, window);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (reloadWindow)
+        {
+            ShaderWorkerHooks hooks;
+            hooks.makeCurrent = [reloadWindow]() { glfwMakeContextCurrent(reloadWindow); return true; };
+            hooks.doneCurrent = []() { glfwMakeContextCurrent(NULL); };
+            hooks.wake = []() { redraw.markDirty(REDRAW_DATA); };
+            shaderLibrary.watch(options.shaders, hooks);
+        }
+        else
+            error_callback(404, "Shader reload context creation failed!");
     }
 
-    // fragment shader
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
+    if (options.benchmark)
     {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+        runBenchmark(window);
+        glfwTerminate();
+        return 0;
     }
 
-    unsigned int fragmentShader2 = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader2, 1, &fragmentShaderSource2, NULL);
-    glCompileShader(fragmentShader2);
-    glGetShaderiv(fragmentShader2, GL_COMPILE_STATUS, &success);
-    if (!success)
+    Scene scene;
+    if (!initScene(scene))
     {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+        shaderLibrary.stop();
+        destroyScene(scene);
+        glfwTerminate();
+        return EXIT_FAILURE;
     }
 
-    unsigned int fragmentShader3 = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader3, 1, &fragmentShaderSource3, NULL);
-    glCompileShader(fragmentShader3);
-    glGetShaderiv(fragmentShader3, GL_COMPILE_STATUS, &success);
-    if (!success)
+    // The shaders requested by initScene() compile in the background while the rest is set up.
+    PartialRedraw partialRedraw;
+    std::vector<PixelRect> redrawRegions;
     {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+        PROFILE_ZONE("window setup");
+        // Only the parts of the window that changed are redrawn, into a framebuffer that keeps the last frame.
+        partialRedraw.init(PRESENT_RETAINED);
+        frameTimer.init(true, options.timings != NULL);
+
+        /*
+        The first two parameters of glViewport set the location of the lower left corner of the window.
+        The third and fourth parameter set the width and height of the rendering window in pixels,
+        which we set equal to GLFW's window size.
+        glViewport(0,0, 640, 480);
+
+        Behind the scenes OpenGL uses the data specified via glViewport to transform the 2D coordinates
+         it processed to coordinates on your screen.
+        For example, a processed point of location (-0.5,0.5) would (as its final transformation)
+         be mapped to (200,450) in screen coordinates.
+        Note that processed coordinates in OpenGL are between -1 and 1 so we effectively map
+         from the range (-1 to 1) to (0, 800) and (0, 600).
+        */
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        // called when the window contents were damaged, e.g. after being uncovered or restored
+        glfwSetWindowRefreshCallback(window, window_refresh_callback);
     }
 
-    unsigned int fragmentShader4 = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader4, 1, &fragmentShaderSource4, NULL);
-    glCompileShader(fragmentShader4);
-    glGetShaderiv(fragmentShader4, GL_COMPILE_STATUS, &success);
-    if (!success)
+    // uncomment this call to draw in wireframe polygons.
+    //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+
+    // RENDER LOOP
+    int result = 0;
+    while (!glfwWindowShouldClose(window))
     {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+        /* Programs still being built.
+        Frames draw whatever is ready; everything drawn so far may be missing panels, so once a program
+        becomes ready the whole window is redrawn and the cached layers rendered again.
+        */
+        if (shaderPipeline.pendingCount())
+        {
+            if (shaderPipeline.poll())
+            {
+                layerCache.invalidateAll();
+                damage.damageAll();
+                redraw.markDirty(REDRAW_DATA);
+            }
+            if (shaderPipeline.pendingCount())
+                redraw.scheduleFrameAt(glfwGetTime() + 0.005);
+            else
+                programCache.printStats();
+        }
+        // while the shaders are being edited a broken one can still be fixed
+        if (shaderPipeline.failedCount() && !shaderLibrary.isWatching())
+        {
+            result = EXIT_FAILURE;
+            break;
+        }
+
+        /* Wait for and process events.
+        Checks if any events are triggered (like keyboard input or mouse movement events),
+        updates the window state, and calls the corresponding functions
+        (which we can register via callback methods).
+        Unless --continuous is used this sleeps until something marks the frame dirty,
+        so a UI where nothing changes doesn't keep a CPU core busy redrawing the same picture.
+        */
+        frameTimer.beginFrame();
+        frameTimer.begin(FRAME_EVENTS);
+        redraw.waitForEvents();
+        frameTimer.end(FRAME_EVENTS);
+        if (!redraw.needsRedraw())
+        {
+            frameTimer.discardFrame();
+            continue;
+        }
+        redraw.beginFrame();
+
+        frameTimer.begin(FRAME_UPDATE);
+        frameSync.beginFrame();
+        glState.beginFrame();
+
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        damage.resize(width, height);
+        partialRedraw.resize(width, height);
+
+        updateScene(scene);
+        // swaps in shaders the hot reload rebuilt, everything on screen was drawn with the old ones
+        if (shaderLibrary.update())
+        {
+            layerCache.invalidateAll();
+            damage.damageAll();
+        }
+        glState.viewport(0, 0, width, height);
+        layerCache.beginFrame(width, height);
+        frameTimer.end(FRAME_UPDATE);
+
+        frameTimer.begin(FRAME_SUBMIT);
+        frameTimer.beginGpu();
+        if (!partialRedraw.beginFrame(damage, redrawRegions))
+        {
+            glClear(GL_COLOR_BUFFER_BIT); // Clears screen
+            //glClearColor(0.0f, 0.4f, 0.0f, 1.0f);
+            drawScene(scene);
+        }
+        else
+        {
+            // Redraw only the damaged regions. The scissor test limits both the clear and the draw to them.
+            glState.setScissorTest(true);
+            for (const PixelRect& region : redrawRegions)
+            {
+                glState.scissor(region.x, region.y, region.w, region.h);
+                glClear(GL_COLOR_BUFFER_BIT);
+                drawScene(scene);
+            }
+            glState.setScissorTest(false);
+        }
+        partialRedraw.endFrame();
+        damage.endFrame();
+        frameTimer.endGpu();
+        frameSync.endFrame();
+        frameTimer.end(FRAME_SUBMIT);
+
+        /* Swap front and back buffers.
+        Will swap the color buffer
+        (a large 2D buffer that contains color values for each pixel in GLFW's window)
+        that is used to render to during this render iteration and show it as output to the screen.
+        */
+        frameTimer.begin(FRAME_SWAP);
+        glfwSwapBuffers(window);
+        frameTimer.end(FRAME_SWAP);
+        redraw.frameDrawn();
+        frameTimer.add(FRAME_STALL, frameSync.frameStallMs());
+        frameTimer.endFrame();
     }
 
-    // link shaders
+    if (options.timings)
+        exportTimings(options.timings);
+    frameTimer.destroy();
+    partialRedraw.destroy();
+    shaderLibrary.stop();
+    destroyScene(scene);
+
+    glfwTerminate();
+    return result;
+}
+
+// Loads the entry points newer than OpenGL 3.3 and opens the program cache, before any program is built.
+static void initExtensions(const Options& options, GLADloadproc loader)
+{
+    glExt.load(loader);
+    if (!options.separateShaders)
+        glExt.separateShaderObjects = false;
+    if (!options.directStateAccess)
+        glExt.directStateAccess = false;
+    if (options.shaderCache)
+        programCache.init(options.shaderCache);
+    shaderPipeline.init();
+}
+
+static bool initScene(Scene& scene)
+{
+    PROFILE_ZONE("initScene");
+    // build and compile our shader program
     /*
-    The glCreateProgram function creates a program and returns the ID reference to the newly created program object. 
-    Now we need to attach the previously compiled shaders to the program object and then link them with glLinkProgram: 
+    All panels share one program. The colors used to be constants in four different fragment shaders,
+    which meant four programs and a glUseProgram for every panel. Now they live in a uniform buffer of
+    materials and every panel just says which material it uses.
     */
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    MaterialTable& materials = scene.materials;
+    materials.init();
+    for (unsigned int i = 1; i < MATERIAL_COUNT; i++)
+    {
+        const float* color = materialColors[i].color;
+        materials.add(color[0], color[1], color[2], color[3]);
     }
+    materials.upload();
 
-    unsigned int shaderProgram2 = glCreateProgram();
-    glAttachShader(shaderProgram2, vertexShader);
-    glAttachShader(shaderProgram2, fragmentShader2);
-    glLinkProgram(shaderProgram2);
-    glGetProgramiv(shaderProgram2, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram2, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
+    // set up vertex data (and buffer(s)) and configure vertex attributes
+    /*
+    Instead of one VBO/VAO per shape, every panel is one 32 byte instance of a shared unit quad.
+    Since the panels never change they are uploaded once, before the render loop.
+    */
+    if (!scene.rects.init(PANEL_COUNT) || !scene.topBar.init(1))
+        return false;
+    scene.rects.begin();
+    for (unsigned int i = 0; i < PANEL_COUNT; i++)
+        if (i != TOP_PANEL)
+            scene.rects.submit(panels[i]);
+    scene.rects.end();
+    // The top bar never changes, so it is drawn through the layer cache as one texture.
+    // It doesn't overlap any other panel, so drawing it last keeps the picture the same.
+    scene.topBar.begin();
+    scene.topBar.submit(panels[TOP_PANEL]);
+    scene.topBar.end();
+    // per-draw constants, only the top bar's composite rectangle so far
+    if (!uniformRing.init(64 * 1024))
+        return false;
+    return layerCache.init(16 * 1024 * 1024);
+}
 
-    unsigned int shaderProgram3 = glCreateProgram();
-    glAttachShader(shaderProgram3, vertexShader);
-    glAttachShader(shaderProgram3, fragmentShader3);
-    glLinkProgram(shaderProgram3);
-    glGetProgramiv(shaderProgram3, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram3, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+// Applies changes made by the input callbacks before a frame is drawn.
+static void updateScene(Scene& scene)
+{
+    if (sidePanelHighlighted != scene.sidePanelWasHighlighted)
+    {
+        scene.sidePanelWasHighlighted = sidePanelHighlighted;
+        if (sidePanelHighlighted)
+            scene.materials.set(MATERIAL_ORANGE, 1.0f, 0.6f, 0.1f, 1.0f);
+        else
+            scene.materials.set(MATERIAL_ORANGE, 0.69f, 0.42f, 0.0f, 1.0f);
+        scene.materials.upload();
     }
+}
 
-    unsigned int shaderProgram4 = glCreateProgram();
-    glAttachShader(shaderProgram4, vertexShader);
-    glAttachShader(shaderProgram4, fragmentShader4);
-    glLinkProgram(shaderProgram4);
-    glGetProgramiv(shaderProgram4, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram3, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
+// Every panel in one draw call, plus the cached top bar. Expects layerCache.beginFrame() to have been called.
+static void drawScene(Scene& scene)
+{
+    scene.materials.bind();
+    scene.queue.submit(scene.rects.drawCommand());
+    scene.queue.flush();
+    const RectInstance& top = panels[TOP_PANEL];
+    layerCache.draw(LAYER_TOP_BAR, top.x, top.y, top.w, top.h, [&]() {
+        scene.queue.submit(scene.topBar.drawCommand());
+        scene.queue.flush();
+    });
+}
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    glDeleteShader(fragmentShader2);
-    glDeleteShader(fragmentShader3);
-    glDeleteShader(fragmentShader4);
+static void destroyScene(Scene& scene)
+{
+    layerCache.destroy();
+    scene.topBar.destroy();
+    scene.rects.destroy();
+    scene.materials.destroy();
+    shaderPipeline.destroy();
+    uniformRing.destroy();
+    frameSync.destroy();
+}
 
-    // set up vertex data (and buffer(s)) and configure vertex attributes
-    float vertices[] = {
-    //    X,     Y,    Z coordinates.
-       -1.0f,  -0.90f,  0.0f,  // top left
-       -1.0f,  -0.25f,  0.0f,  // Bottom left
-        1.0f,  -0.25f,  0.0f,  // Bottom right
-
-        1.0f,  -0.25f,  0.0f,  // top left
-        1.0f,  -0.90f,  0.0f,  // Bottom left
-       -1.0f,  -0.90f,  0.0f  // Bottom right
-    };
-
-    float vertices2[] = {
-        -1.0f,   -0.20f,  0.0f,  // top left
-        -1.0f,    0.85f,  0.0f,  // Bottom left
-         1.0f,    0.85f,  0.0f,  // Bottom right
-
-        1.0f,    0.85f,  0.0f,  // top left
-        1.0f,   -0.20f,  0.0f,  // Bottom left
-       -1.0f,   -0.20f,  0.0f,  // Bottom right
-
-       //Second panel
-       -1.0f,   0.85f,  0.0f,  // top left
-       -1.0f,   1.0f,  0.0f,  // Bottom left
-        1.0f,   1.0f,  0.0f,  // Bottom right
-
-        1.0f,   1.0f,  0.0f,  // top left
-        1.0f,   0.85f,  0.0f,  // Bottom left
-       -1.0f,   0.85f,  0.0f  // Bottom right
-    };
-
-    float vertices3[] = {
-       -0.97f,   -0.15f,  0.0f,  // top left
-       -0.97f,    0.80f,  0.0f,  // Bottom left
-       -0.35f,    0.80f,  0.0f,  // Bottom right
-
-       -0.35f,    0.80f,  0.0f,  // top left
-       -0.35f,   -0.15f,  0.0f,  // Bottom left
-       -0.97f,   -0.15f,  0.0f  // Bottom right
-    };
-
-    unsigned int indices[] = {
-        0, 1, 3, // first triangle
-        1, 3, 2 // second triangle
-    };
+/*
+Draws the same UI as the window, but into a framebuffer object of a context without a window,
+so it runs on machines without a display server or GPU (Mesa's llvmpipe is enough).
+Every frame is a full repaint followed by glFinish, the average frame time is printed at the end.
+With --bench the benchmark runs into the offscreen framebuffer instead.
+*/
+static int runHeadless(const Options& options)
+{
+    HeadlessContext context;
+    {
+        PROFILE_ZONE("HeadlessContext::create");
+        if (!context.create())
+        {
+            error_callback(404, "Headless OpenGL context creation failed!");
+            return EXIT_FAILURE;
+        }
+    }
+    {
+        PROFILE_ZONE("gladLoadGLLoader");
+        if (!gladLoadGLLoader(context.loader()))
+        {
+            error_callback(400, "Failed to initialize GLAD");
+            context.destroy();
+            return EXIT_FAILURE;
+        }
+    }
+    initExtensions(options, context.loader());
 
-    /*
-    With the vertex data defined we'd like to send it as input to the first process of the graphics pipeline: the vertex shader.
-    This is done by creating memory on the GPU where we store the vertex data,
-      configure how OpenGL should interpret the memory and specify how to send the data to the graphics card.
-    The vertex shader then processes as much vertices as we tell it to from its memory.
-
-    We manage this memory via so called vertex buffer objects (VBO) that can store a large number of vertices in the GPU's memory.
-    The advantage of using those buffer objects is that we can send large batches of data all at once to the graphics card,
-      and keep it there if there's enough memory left, without having to send data one vertex at a time.
-    Sending data to the graphics card from the CPU is relatively slow,
-      so wherever we can we try to send as much data as possible at once.
-    Once the data is in the graphics card's memory the vertex shader has almost instant access to the vertices
-      making it extremely fast
-    */
-    unsigned int VBO[3], VAO[3], EBO;
-    glGenVertexArrays(1, &VAO[0]);
-    glGenBuffers(1, &VBO[0]);
-    glGenBuffers(1, &EBO);
-    // bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex attribute(s).
-    glBindVertexArray(VAO[0]);
-    /*
-    glBufferData is a function specifically targeted to copy user-defined data into the currently bound buffer.
-    The first argument is the type of the buffer we want to copy data into: the vertex buffer object currently
-      bound to the GL_ARRAY_BUFFER target.
-    The second argument specifies the size of the data (in bytes) we want to pass to the buffer;
-      a simple sizeof of the vertex data suffices.
-    The third parameter is the actual data we want to send.
-    The fourth parameter specifies how we want the graphics card to manage the given data. This can take 3 forms:
-        - GL_STREAM_DRAW: the data is set only once and used by the GPU at most a few times.
-        - GL_STATIC_DRAW: the data is set only once and used many times.
-        - GL_DYNAMIC_DRAW: the data is changed a lot and used many times.
-    */
-    // 0. copy our vertices array in a buffer for OpenGL to use
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    glGenVertexArrays(1, &VAO[1]);
-    glGenBuffers(1, &VBO[1]);
-    glBindVertexArray(VAO[1]);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices2), vertices2, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    glGenVertexArrays(1, &VAO[2]);
-    glGenBuffers(1, &VBO[2]);
-    glBindVertexArray(VAO[2]);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[2]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices3), vertices3, GL_STATIC_DRAW);
-    // copy our index array in a element buffer for OpenGL to use
-    /*glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices),indices, GL_STATIC_DRAW);*/
-    // 1. then set the vertex attribute pointers
-    /*
-    The first parameter specifies which vertex attribute we want to configure.
-      Remember that we specified the location of the position vertex attribute in the vertex shader with layout (location = 0).
-      This sets the location of the vertex attribute to 0 and since we want to pass data to this vertex attribute, we pass in 0.
-    The next argument specifies the size of the vertex attribute. The vertex attribute is a vec3 so it is composed of 3 values.
-    The third argument specifies the type of the data which is GL_FLOAT (a vec* in GLSL consists of floating point values).
-    The next argument specifies if we want the data to be normalized.
-      If we're inputting integer data types (int, byte) and we've set this to GL_TRUE,
-       the integer data is normalized to 0 (or -1 for signed data) and 1 when converted to float.
-      This is not relevant for us so we'll leave this at GL_FALSE.
-    The fifth argument is known as the stride and tells us the space between consecutive vertex attributes.
-      Since the next set of position data is located exactly 3 times the size of a float away we specify that value as the stride.
-      Note that since we know that the array is tightly packed (there is no space between the next vertex attribute value)
-        we could've also specified the stride as 0 to let OpenGL determine the stride
-        (this only works when values are tightly packed).
-      Whenever we have more vertex attributes we have to carefully define the spacing between each vertex attribute
-       but we'll get to see more examples of that later on.
-    The last parameter is of type void* and thus requires that weird cast.
-     This is the offset of where the position data begins in the buffer.
-     Since the position data is at the start of the data array this value is just 0.
-     We will explore this parameter in more detail later on
-    */
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // 2. use our shader program when we want to render an object
-    //glUseProgram(shaderProgram);
-    // 3. now draw the object
-    // someOpenGLFunctionThatDrawsOurTriangle();
-    /*
-    We have to repeat this process every time we want to draw an object. 
-    It may not look like that much, but imagine if we have over 5 vertex attributes and perhaps 100s of different objects 
-     (which is not uncommon). 
-    Binding the appropriate buffer objects and configuring all vertex attributes for each of those objects quickly 
-     becomes a cumbersome process. 
-    What if there was some way we could store all these state configurations into an object and simply bind this object to 
-     restore its state? 
-    */
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    // ..:: Drawing code (in render loop) ::..
-    // 
-    glBindVertexArray(0);
-    // 4. draw the object
-    /*glUseProgram(shaderProgram);
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 3);*/
-    //glBindVertexArray(0);
-    // someOpenGLFunctionThatDrawsOurTriangle();
+    OffscreenTarget target;
+    if (!target.create(SCR_WIDTH, SCR_HEIGHT))
+    {
+        context.destroy();
+        return EXIT_FAILURE;
+    }
+    target.bind();
+    glState.viewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
 
-    /*
-    The first two parameters of glViewport set the location of the lower left corner of the window.
-    The third and fourth parameter set the width and height of the rendering window in pixels,
-    which we set equal to GLFW's window size.
-    glViewport(0,0, 640, 480);
-
-    Behind the scenes OpenGL uses the data specified via glViewport to transform the 2D coordinates
-     it processed to coordinates on your screen.
-    For example, a processed point of location (-0.5,0.5) would (as its final transformation)
-     be mapped to (200,450) in screen coordinates.
-    Note that processed coordinates in OpenGL are between -1 and 1 so we effectively map
-     from the range (-1 to 1) to (0, 800) and (0, 600).
-    */
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    int result = 0;
+    if (options.benchmark)
+        runBenchmark(NULL);
+    else
+    {
+        Scene scene;
+        bool ready = initScene(scene);
+        // unlike the window, every frame here should show the finished picture
+        shaderPipeline.finish();
+        if (ready && !shaderPipeline.failedCount())
+        {
+            programCache.printStats();
+            frameTimer.init(true, options.timings != NULL);
+            for (int frame = 0; frame < options.frames; frame++)
+            {
+                frameTimer.beginFrame();
+                frameTimer.begin(FRAME_UPDATE);
+                frameSync.beginFrame();
+                glState.beginFrame();
+                updateScene(scene);
+                layerCache.beginFrame(SCR_WIDTH, SCR_HEIGHT);
+                frameTimer.end(FRAME_UPDATE);
+
+                frameTimer.begin(FRAME_SUBMIT);
+                frameTimer.beginGpu();
+                glClear(GL_COLOR_BUFFER_BIT);
+                drawScene(scene);
+                frameTimer.endGpu();
+                frameSync.endFrame();
+                frameTimer.end(FRAME_SUBMIT);
+                // stands in for the swap, so frames don't pile up in the driver
+                frameTimer.begin(FRAME_SWAP);
+                glFinish();
+                frameTimer.end(FRAME_SWAP);
+                frameTimer.add(FRAME_STALL, frameSync.frameStallMs());
+                frameTimer.endFrame();
+            }
+            printf("%d frames\n", options.frames);
+            frameTimer.printSummary();
+            if (options.timings && !exportTimings(options.timings))
+                result = EXIT_FAILURE;
+            frameTimer.destroy();
+            if (options.output && !target.writePPM(options.output))
+                result = EXIT_FAILURE;
+        }
+        else
+            result = EXIT_FAILURE;
+        destroyScene(scene);
+    }
 
-    // uncomment this call to draw in wireframe polygons.
-    //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    target.destroy();
+    context.destroy();
+    return result;
+}
 
-    // RENDER LOOP
-    while (!glfwWindowShouldClose(window))
+/*
+Draws the UI with the software rasterizer. No OpenGL context is created at all, so this works on servers
+without a GPU or Mesa. With --bench it measures how the rasterizer scales with the number of threads.
+*/
+static int runSoftware(const Options& options)
+{
+    if (options.benchmark)
     {
-        glClear(GL_COLOR_BUFFER_BIT); // Clears screen
-        //glClearColor(0.0f, 0.4f, 0.0f, 1.0f);
-
-        // triangle 1
-        glUseProgram(shaderProgram);
-        glBindVertexArray(VAO[0]);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        // triangle 2
-        glUseProgram(shaderProgram2);
-        glBindVertexArray(VAO[1]);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        //glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0);
-
-        // Top panel
-        glUseProgram(shaderProgram4);
-        glBindVertexArray(VAO[1]);
-        glDrawArrays(GL_TRIANGLES, 6, 12);
-
-        // triangle 3
-        glUseProgram(shaderProgram3);
-        glBindVertexArray(VAO[2]);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        /* Swap front and back buffers.
-        Will swap the color buffer
-        (a large 2D buffer that contains color values for each pixel in GLFW's window)
-        that is used to render to during this render iteration and show it as output to the screen.
-        */
-        glfwSwapBuffers(window);
+        runSoftwareBenchmark();
+        return 0;
+    }
 
-        /* Poll for and process events.
-        Checks if any events are triggered (like keyboard input or mouse movement events),
-        updates the window state, and calls the corresponding functions
-        (which we can register via callback methods).
-        */
-        glfwPollEvents();
+    SoftwareRasterizer rasterizer;
+    rasterizer.resize(SCR_WIDTH, SCR_HEIGHT);
+    frameTimer.init(false, options.timings != NULL);
+    for (int frame = 0; frame < options.frames; frame++)
+    {
+        frameTimer.beginFrame();
+        frameTimer.begin(FRAME_SUBMIT);
+        rasterizer.clear(0.0f, 0.0f, 0.0f, 0.0f);
+        rasterizer.drawRects(panels, PANEL_COUNT, materialColors, MATERIAL_COUNT);
+        rasterizer.flush();
+        frameTimer.end(FRAME_SUBMIT);
+        frameTimer.endFrame();
     }
+    printf("%d frames (%u threads, %s)\n", options.frames, rasterizer.threadCount(), rasterizer.simdPath());
+    frameTimer.printSummary();
 
-    glDeleteVertexArrays(1, &VAO[0]);
-    glDeleteVertexArrays(1, &VAO[1]);
-    glDeleteVertexArrays(1, &VAO[2]);
-    glDeleteBuffers(1, &VBO[0]);
-    glDeleteBuffers(1, &VBO[1]);
-    glDeleteBuffers(1, &VBO[2]);
-    glDeleteBuffers(1, &EBO);
-    glDeleteProgram(shaderProgram);
-    glDeleteProgram(shaderProgram2);
-    glDeleteProgram(shaderProgram3);
-    glDeleteProgram(shaderProgram4);
+    int result = 0;
+    if (options.timings && !exportTimings(options.timings))
+        result = EXIT_FAILURE;
+    if (options.output)
+    {
+        std::vector<unsigned char> rgba;
+        rasterizer.readPixels(rgba);
+        if (!writePPM(options.output, rgba, rasterizer.getWidth(), rasterizer.getHeight()))
+            result = EXIT_FAILURE;
+    }
+    return result;
+}
 
-    glfwTerminate();
-    return 0;
+static bool exportTimings(const char* path)
+{
+    size_t length = strlen(path);
+    if (length >= 5 && strcmp(path + length - 5, ".json") == 0)
+        return frameTimer.exportJSON(path);
+    return frameTimer.exportCSV(path);
 }
 
 void error_callback(int error, const char* description)
@@ -432,23 +660,72 @@ void character_callback(GLFWwindow* window, unsigned int codepoint)
     std::cout << (char)codepoint;
 }
 
+// The clear color only shows where no panel covers the background, so only those parts need a redraw.
+static void damageBackground()
+{
+    damage.damageUncoveredNDC(&panels[0].x, PANEL_COUNT, sizeof(RectInstance) / sizeof(float));
+    redraw.markDirty(REDRAW_INPUT);
+}
+
 static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, GLFW_TRUE);
     if (key == GLFW_KEY_UP && action == GLFW_PRESS)
-        glClearColor(0.4f, 0.0, 0.0, 0.0);
+    {
+        glState.clearColor(0.4f, 0.0, 0.0, 0.0);
+        damageBackground();
+    }
     if (key == GLFW_KEY_DOWN && action == GLFW_PRESS)
-        glClearColor(0.0, 0.4f, 0.0, 0.0);
+    {
+        glState.clearColor(0.0, 0.4f, 0.0, 0.0);
+        damageBackground();
+    }
     if (key == GLFW_KEY_LEFT && action == GLFW_PRESS)
-        glClearColor(0.0, 0.0, 0.4f, 0.0);
+    {
+        glState.clearColor(0.0, 0.0, 0.4f, 0.0);
+        damageBackground();
+    }
     if (key == GLFW_KEY_RIGHT && action == GLFW_PRESS)
-        glClearColor(0.4f, 0.4f, 0.0, 0.0);
+    {
+        glState.clearColor(0.4f, 0.4f, 0.0, 0.0);
+        damageBackground();
+    }
+    // F2 toggles the side panel highlight, only the side panel has to be redrawn.
+    if (key == GLFW_KEY_F2 && action == GLFW_PRESS)
+    {
+        sidePanelHighlighted = !sidePanelHighlighted;
+        const RectInstance& side = panels[SIDE_PANEL];
+        damage.damageNDC(side.x, side.y, side.w, side.h);
+        redraw.markDirty(REDRAW_INPUT);
+    }
+    // F1 shows how many state changes the last frame sent to the driver and how many were dropped.
+    if (key == GLFW_KEY_F1 && action == GLFW_PRESS)
+    {
+        const GLStateStats& stats = glState.lastFrame();
+        std::cout << "GL state changes: " << stats.issued << " issued, " << stats.filtered << " filtered" << std::endl;
+    }
+    // F3 shows how well the layer cache is doing.
+    if (key == GLFW_KEY_F3 && action == GLFW_PRESS)
+    {
+        const LayerCacheStats& stats = layerCache.getStats();
+        std::cout << "Layer cache: " << stats.hits << " hits, " << stats.misses << " misses, "
+            << stats.evictions << " evictions, " << stats.bytesUsed / 1024 << " KB" << std::endl;
+    }
+    // F4 shows the frame time percentiles of the last frames.
+    if (key == GLFW_KEY_F4 && action == GLFW_PRESS)
+        frameTimer.printSummary();
     if (key == GLFW_KEY_ENTER && action == GLFW_PRESS)
         std::cout << std::endl;
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-    glViewport(0, 0, width, height);
+    glState.viewport(0, 0, width, height);
+    redraw.markDirty(REDRAW_RESIZE);
+}
+
+void window_refresh_callback(GLFWwindow* window)
+{
+    redraw.markDirty(REDRAW_EXPOSE);
 }
\ No newline at end of file